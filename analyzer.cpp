@@ -18,13 +18,15 @@
 
 #include "analyzer.h"
 
+#include "log.h"
+#include "profiler.h"
+#include "stats.h"
 #include "translator.h"
 #include "yaml.h"
 
 #include <QtCore/QUrl>
 
 #include <algorithm>
-#include <iostream>
 
 using namespace std;
 namespace fs = filesystem;
@@ -62,6 +64,93 @@ public:
 };
 
 Analyzer::models_t Analyzer::_allModels {};
+mutex Analyzer::_modelsMutex {};
+condition_variable Analyzer::_modelReleased {};
+unordered_map<string, Analyzer::ModelOwner> Analyzer::_modelOwners {};
+unordered_map<thread::id, string> Analyzer::_awaitedModels {};
+
+/// \brief Exclusive access to a model in the registry, for the lifetime of the lock
+///
+/// The constructor finds or creates the model with the given key and, if another thread
+/// owns that model at the moment, waits until it's released. This ensures that a model
+/// $ref'ed from several files is analysed only once. The same thread can lock the same model
+/// again, which is how recursive references have always been dealt with.
+///
+/// If the owner (transitively) waits for a model locked by this thread, the models refer to
+/// each other across threads. Instead of waiting forever, this thread then borrows the model
+/// from the blocked owner and returns it on unlocking; the outcome is the same as if one thread
+/// had followed the references recursively.
+class Analyzer::ModelLock {
+public:
+    explicit ModelLock(string modelKey) : _modelKey(std::move(modelKey))
+    {
+        const auto thisThread = this_thread::get_id();
+        unique_lock lock(_modelsMutex);
+        if (const auto ownerIt = _modelOwners.find(_modelKey);
+            ownerIt != _modelOwners.end() && ownerIt->second.threadId != thisThread) {
+            if (waitsForThisThread(ownerIt->second.threadId)) {
+                _lender = exchange(ownerIt->second, {thisThread, 0});
+            } else {
+                _awaitedModels.emplace(thisThread, _modelKey);
+                _modelReleased.wait(lock, [this] { return !_modelOwners.contains(_modelKey); });
+                _awaitedModels.erase(thisThread);
+            }
+        }
+        auto& owner = _modelOwners[_modelKey];
+        owner.threadId = thisThread;
+        ++owner.depth;
+        const auto [modelIt, unseen] = _allModels.try_emplace(_modelKey);
+        _model = &modelIt->second;
+        _unseen = unseen;
+    }
+    ~ModelLock()
+    {
+        const lock_guard lock(_modelsMutex);
+        if (const auto ownerIt = _modelOwners.find(_modelKey); --ownerIt->second.depth == 0) {
+            if (_lender)
+                ownerIt->second = *_lender; // The lender is still blocked, see the constructor
+            else {
+                _modelOwners.erase(ownerIt);
+                _modelReleased.notify_all();
+            }
+        }
+    }
+    ModelLock(const ModelLock&) = delete;
+    void operator=(const ModelLock&) = delete;
+
+    [[nodiscard]] Model& model() const { return *_model; }
+    //! Whether the model has been created by this lock, rather than found in the registry
+    [[nodiscard]] bool unseen() const { return _unseen; }
+
+private:
+    string _modelKey;
+    Model* _model;
+    bool _unseen;
+    //! The owner this thread has borrowed the model from
+    optional<ModelOwner> _lender;
+
+    //! Whether \p owner is blocked until this thread releases some model; needs _modelsMutex
+    static bool waitsForThisThread(thread::id owner)
+    {
+        for (;;) {
+            const auto awaitedIt = _awaitedModels.find(owner);
+            if (awaitedIt == _awaitedModels.end())
+                return false;
+            const auto nextOwnerIt = _modelOwners.find(awaitedIt->second);
+            if (nextOwnerIt == _modelOwners.end())
+                return false; // The awaited model has just been released
+            if (nextOwnerIt->second.threadId == this_thread::get_id())
+                return true;
+            owner = nextOwnerIt->second.threadId;
+        }
+    }
+};
+
+void Analyzer::evictModel(const string& modelKey)
+{
+    if (const auto it = _allModels.find(modelKey); it != _allModels.end())
+        it->second.evict();
+}
 
 Analyzer::Analyzer(const Translator& translator, fspath basePath)
     : _baseDir(std::move(basePath))
@@ -69,8 +158,8 @@ Analyzer::Analyzer(const Translator& translator, fspath basePath)
 {
     if (!fs::is_directory(_baseDir))
         throw Exception("Base path " + _baseDir.string() + " is not a directory");
-    cout << "Using " << _baseDir << " as a base directory for YAML/JSON files"
-         << endl;
+    if (auto msg = debugLog())
+        msg << "Using " << _baseDir << " as a base directory for YAML/JSON files";
 }
 
 TypeUsage Analyzer::analyzeTypeUsage(const YamlMap<>& node)
@@ -120,8 +209,9 @@ TypeUsage Analyzer::addSchema(ObjectSchema&& schema)
     // This is just to enrich the type usage with attributes, not
     // for type substitution
     auto tu = _translator.mapType("schema", schema.name);
-    if (const auto titleAttrIt = tu.attributes.find("title"s); titleAttrIt != tu.attributes.end())
-        schema.name = titleAttrIt->second;
+    if (const auto titleAttrIt = tu.attributes().find("title"s);
+        titleAttrIt != tu.attributes().end())
+        schema.name = Symbol(titleAttrIt->second);
     tu.name = schema.name;
     tu.call = schema.call;
     currentModel().addSchema(std::move(schema), tu);
@@ -144,8 +234,9 @@ TypeUsage Analyzer::analyzeMultitype(const YamlSequence<>& yamlTypes)
     }
 
     const auto& protoType = _translator.mapType("variant", baseTypes, baseTypes);
-    cout << logOffset() << "Using " << protoType.qualifiedName()
-         << " for a multitype: " << baseTypes << endl;
+    if (auto msg = debugLog())
+        msg << logOffset() << "Using " << protoType.qualifiedName()
+            << " for a multitype: " << baseTypes;
     return protoType.specialize(std::move(tus));
 }
 
@@ -158,21 +249,19 @@ ObjectSchema Analyzer::analyzeSchema(const YamlMap<>& schemaYaml, RefsStrategy r
                         ? analyzeObject(schemaYaml, refsStrategy)
                         : makeTrivialSchema(analyzeTypeUsage(schemaYaml));
 
-    if (!schema.empty()) {
-        cout << logOffset() << schemaYaml.location() << ": schema for "
-             << schema;
+    if (auto msg = debugLog(); msg && !schema.empty()) {
+        msg << logOffset() << schemaYaml.location() << ": schema for " << schema;
         if (const auto& scopeName = currentScope().name; !scopeName.empty())
-            cout << '/' << scopeName;
+            msg << '/' << scopeName;
         if (schema.trivial())
-            cout << " mapped to " << schema.parentTypes.front().qualifiedName();
+            msg << " mapped to " << schema.parentTypes.front().qualifiedName();
         else {
-            cout << " (parent(s): " << schema.parentTypes.size()
-                 << ", field(s): " << schema.fields.size();
+            msg << " (parent(s): " << schema.parentTypes.size()
+                << ", field(s): " << schema.fields.size();
             if (!schema.additionalProperties.type.empty())
-                cout << ", and additional properties";
-            cout << ")";
+                msg << ", and additional properties";
+            msg << ")";
         }
-        cout << '\n';
     }
     return std::move(schema);
 }
@@ -215,6 +304,8 @@ ObjectSchema Analyzer::analyzeObject(const YamlMap<>& yamlSchema, RefsStrategy r
         if (auto&& tu = _translator.mapType("schema", name); !tu.empty())
             return makeTrivialSchema(std::move(tu));
     }
+    // Anonymous schemas are traced as a part of their enclosing schema or model
+    const Profiler::TraceSpan _traceSpan(Profiler::Analysis, name);
 
     yamlSchema.maybeLoad("maxProperties", &schema.maxProperties);
     // Don't bother parsing parents and properties if the schema is known to be empty
@@ -234,10 +325,10 @@ ObjectSchema Analyzer::analyzeObject(const YamlMap<>& yamlSchema, RefsStrategy r
                   std::back_inserter(schema.parentTypes));
         if (!innerSchema.description.empty())
             schema.description = innerSchema.description;
-        for (auto&& f: innerSchema.fields) {
+        for (auto&& f: innerSchema.fields.release()) {
             // Re-map the identifier name using the current schema as scope
             // (f has been produced with innerSchema as scope)
-            f.name = _translator.mapIdentifier(f.baseName, &schema, f.required);
+            f.name = Symbol(_translator.mapIdentifier(f.baseName, &schema, f.required));
             if (!f.name.empty())
                 addVarDecl(schema.fields, std::move(f));
         }
@@ -247,7 +338,7 @@ ObjectSchema Analyzer::analyzeObject(const YamlMap<>& yamlSchema, RefsStrategy r
                 throw YamlException(yamlEntry, "Conflicting property map types when "
                                                "merging properties to the main schema");
 
-            aps.name = _translator.mapIdentifier(aps.baseName, &schema, aps.required);
+            aps.name = Symbol(_translator.mapIdentifier(aps.baseName, &schema, aps.required));
             if (!aps.name.empty())
                 schema.additionalProperties = std::move(aps);
         }
@@ -269,7 +360,7 @@ ObjectSchema Analyzer::analyzeObject(const YamlMap<>& yamlSchema, RefsStrategy r
     if (properties || patternPropertiesYaml || additionalProperties
         || (!schema.empty() && !schema.trivial())) {
         // If the schema is not just an alias for another type, name it.
-        schema.name = titleCased(name);
+        schema.name = Symbol(titleCased(name));
     }
 
     if (properties) {
@@ -319,7 +410,7 @@ ObjectSchema Analyzer::analyzeObject(const YamlMap<>& yamlSchema, RefsStrategy r
     return schema;
 }
 
-Body Analyzer::analyzeBody(const YamlMap<>& contentYaml, string description,
+Body Analyzer::analyzeBody(const YamlMap<>& contentYaml, SharedText description,
                            const string& contentType, bool required, std::string_view name)
 {
     if (currentRole() == InAndOut)
@@ -365,7 +456,7 @@ Body Analyzer::analyzeBody(const YamlMap<>& contentYaml, string description,
             // add a definition for it and make a single parameter with
             // the type of the schema.
             if (bodySchema.name.empty())
-                bodySchema.name = titleCased(string(name));
+                bodySchema.name = Symbol(titleCased(string(name)));
             packedType = addSchema(std::move(bodySchema));
         } else {
             // No parents, non-empty - unpack the schema to body properties
@@ -377,12 +468,14 @@ Body Analyzer::analyzeBody(const YamlMap<>& contentYaml, string description,
     if (auto&& v = makeVarDecl(std::move(packedType), name, location,
                                std::move(description), required))
     {
-        cout << logOffset() << contentYaml.location() << ": substituting the " << location
-             << " body definition with '" << v->type.qualifiedName() << ' ' << v->name << "'\n";
+        if (auto msg = debugLog())
+            msg << logOffset() << contentYaml.location() << ": substituting the " << location
+                << " body definition with '" << v->type.qualifiedName() << ' ' << v->name << "'";
         return *v;
     }
-    cout << logOffset() << contentYaml.location() << location
-         << " body definition has been nullified by configuration\n";
+    if (auto msg = debugLog())
+        msg << logOffset() << contentYaml.location() << location
+            << " body definition has been nullified by configuration";
     return {};
 }
 
@@ -395,8 +488,9 @@ ObjectSchema Analyzer::analyzeRefObject(const YamlMap<>& refObjectYaml, RefsStra
     // First try to resolve refPath in types map
     auto&& tu = _translator.mapReference(refPathForMapping);
     if (!tu.empty()) {
-        cout << logOffset() << "Mapped $ref: " << refPath << " to type usage " << tu.name
-             << " from the configuration\n";
+        if (auto msg = debugLog())
+            msg << logOffset() << "Mapped $ref: " << refPath << " to type usage " << tu.name
+                << " from the configuration";
         return makeTrivialSchema(std::move(tu));
     }
 
@@ -411,7 +505,7 @@ ObjectSchema Analyzer::analyzeRefObject(const YamlMap<>& refObjectYaml, RefsStra
         // branch there
         const ContextOverlay _schemaContext(
             *this,
-            {refPath,
+            {Symbol(refPath),
              InAndOut /* TODO: see loadSchemaFromRef() - we have to have similar stuff here */,
              nullptr}); // NB: schemas in localRefs are considered common, not belonging to any call
         if (auto sIt = currentModel().localRefs.find(refPath);
@@ -419,22 +513,27 @@ ObjectSchema Analyzer::analyzeRefObject(const YamlMap<>& refObjectYaml, RefsStra
         {
             if (refsStrategy != InlineRefs) {
                 tu = sIt->second;
-                cout << logOffset() << "Reusing already loaded mapping " << refPath
-                     << " -> " << tu.name << " with role " << currentRole() << '\n';
+                Stats::add("local $refs", "reused");
+                if (auto msg = debugLog())
+                    msg << logOffset() << "Reusing already loaded mapping " << refPath
+                        << " -> " << tu.name << " with role " << currentRole();
                 return makeTrivialSchema(std::move(tu),
                                          refObjectYaml.maybeGet<string>("description"));
             }
-            cout << logOffset() << refObjectYaml.location() << ": forced inlining of saved schema "
-                 << sIt->second << '\n';
-        }
+            Stats::add("local $refs", "analysed again for inlining");
+            if (auto msg = debugLog())
+                msg << logOffset() << refObjectYaml.location()
+                    << ": forced inlining of saved schema " << sIt->second;
+        } else
+            Stats::add("local $refs", "analysed");
         auto&& s = analyzeSchema(refObjectYaml.resolveRef(YamlNode::SkipOverrides), refsStrategy);
         s.preferInlining = refsStrategy == InlineRefs;
         if (s.name.empty()) {
             if (s.inlined())
                 return std::move(s);
             // Use the $ref's last segment as a fallback for the name
-            s.name =
-                titleCased({find(refPath.crbegin(), refPath.crend(), '/').base(), refPath.cend()});
+            s.name = Symbol(
+                titleCased({find(refPath.crbegin(), refPath.crend(), '/').base(), refPath.cend()}));
         }
 
         tu = addSchema(std::move(s));
@@ -448,16 +547,18 @@ ObjectSchema Analyzer::analyzeRefObject(const YamlMap<>& refObjectYaml, RefsStra
     return dispatchVisit(
         std::move(schemaOrTu),
         [this, refPath, &tu, importPath](TypeUsage&& refTu) {
-            cout << logOffset() << "Resolved $ref: " << refPath << " to type usage " << refTu.name
-                 << '\n';
+            if (auto msg = debugLog())
+                msg << logOffset() << "Resolved $ref: " << refPath << " to type usage "
+                    << refTu.name;
             if (!importPath.empty())
                 refTu.addImport(importPath.string());
-            refTu.importRenderer = tu.importRenderer;
+            refTu.setImportRenderer(tu.importRenderer());
 
             return makeTrivialSchema(std::move(refTu));
         },
         [this, &tu, &refObjectYaml, importPath, hasExtraDeps](ObjectSchema&& s) {
-            refObjectYaml.maybeLoad("description", &s.description);
+            if (auto description = refObjectYaml.maybeGet<string>("description"))
+                s.description = std::move(*description);
 
             if (!importPath.empty())
                 tu.addImport(importPath.string());
@@ -466,8 +567,9 @@ ObjectSchema Analyzer::analyzeRefObject(const YamlMap<>& refObjectYaml, RefsStra
             // depends on other definitions from the same file; but it's
             // not always practical to inline dependencies as well
             if (hasExtraDeps) {
-                cout << logOffset() << "The dependencies will still be imported from " << importPath
-                     << '\n';
+                if (auto msg = debugLog())
+                    msg << logOffset() << "The dependencies will still be imported from "
+                        << importPath;
                 currentModel().addImportsFrom(tu); // Usually one, unless mapType() added more
             }
             return std::move(s);
@@ -487,7 +589,7 @@ ObjectSchema Analyzer::makeTrivialSchema(TypeUsage&& tu,
 
 optional<VarDecl> Analyzer::makeVarDecl(TypeUsage type, string_view baseName,
                                         const Identifier& scope,
-                                        string description, bool required,
+                                        SharedText description, bool required,
                                         string defaultValue) const
 {
     if (auto&& id = _translator.mapIdentifier(baseName, &scope, required); !id.empty())
@@ -498,20 +600,15 @@ optional<VarDecl> Analyzer::makeVarDecl(TypeUsage type, string_view baseName,
 
 void Analyzer::addVarDecl(VarDecls &varList, VarDecl &&v) const
 {
-    const auto vIt = ranges::find(varList, v.name, &VarDecl::name);
-    if (vIt == varList.end()) {
-        varList.emplace_back(std::move(v));
-        return;
-    }
     // throw Exception("Attempt to overwrite field " + v.name);
-    cout << logOffset() << "Warning: re-defining field " << *vIt
-         << ", make sure its schema is inlined or standalone to avoid aliasing\n";
-    *vIt = std::move(v);
+    if (const auto replaced = varList.addOrReplace(std::move(v)))
+        warningLog() << logOffset() << "Warning: re-defining field " << *replaced
+                     << ", make sure its schema is inlined or standalone to avoid aliasing";
 }
 
 void Analyzer::addVarDecl(VarDecls& varList, TypeUsage type,
                           const string& baseName, const Identifier& scope,
-                          string description, bool required,
+                          SharedText description, bool required,
                           string defaultValue) const
 {
     if (auto&& v = makeVarDecl(std::move(type), baseName, scope,
@@ -525,9 +622,9 @@ inline string withoutSuffix(const string& path, string_view suffix)
     return path.substr(0, path.find(suffix, path.size() - suffix.size()));
 }
 
-inline fs::path Analyzer::makeModelKey(const fs::path& sourcePath)
+fs::path Analyzer::makeModelKey(const Translator& translator, const fs::path& sourcePath)
 {
-    return (_translator.outputBaseDir() / withoutSuffix(sourcePath, ".yaml"))
+    return (translator.outputBaseDir() / withoutSuffix(sourcePath, ".yaml"))
         .lexically_normal();
 }
 
@@ -553,16 +650,21 @@ vector<string> loadSwaggerContentTypes(const YamlMap<>& yaml, const char* keyNam
 
 const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
 {
-    cout << "Loading from " << filePath << endl;
+    infoLog() << "Loading from " << filePath;
+    const auto modelKey = makeModelKey(_translator, filePath).string();
+    const Profiler::Scope _profilerScope(Profiler::Analysis, modelKey);
     const auto yaml =
         YamlNode::fromFile(_baseDir / filePath, _translator.substitutions()).as<YamlMap<>>();
-    if (_allModels.contains(filePath)) {
-        clog << "Warning: the model has been loaded from " << filePath
-             << " but will be reloaded again" << endl;
-        _allModels.erase(filePath);
+    const ModelLock modelLock(modelKey);
+    auto& model = modelLock.model();
+    if (!modelLock.unseen()) {
+        warningLog() << "Warning: the model has been loaded from " << filePath
+                     << " but will be reloaded again";
+        Stats::add("models", "reloaded");
+        model.clear();
     }
-    auto&& model = _allModels[makeModelKey(filePath)];
     const ContextOverlay _modelContext(*this, fspath(filePath).parent_path(), &model, inOut);
+    model.role = inOut;
 
     // Detect which file we have: API description or data definition
     // Using YamlGenericMap so that YamlException could be used on the map key
@@ -617,25 +719,28 @@ const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
                                             "should be a map with exactly one pair in it");
                     }
 
-                cout << logOffset() << yamlCall.location() << ": Found operation " << operationId
-                     << " (" << path << ", " << verb << ")\n";
+                if (auto msg = debugLog())
+                    msg << logOffset() << yamlCall.location() << ": Found operation " << operationId
+                        << " (" << path << ", " << verb << ")";
 
                 Call& call = model.addCall(path, std::move(verb), std::move(operationId),
                                            yamlCall.get<bool>("deprecated", false), needsSecurity);
 
                 yamlCall.maybeLoad("summary", &call.summary);
-                yamlCall.maybeLoad("description", &call.description);
+                if (auto description = yamlCall.maybeGet<string>("description"))
+                    call.description = std::move(*description);
                 if (auto&& yamlExternalDocs = yamlCall.maybeGet<YamlMap<string>>("externalDocs"))
                     call.externalDocs = {yamlExternalDocs->get("description", {}),
                                          yamlExternalDocs->get("url")};
                 if (isOpenApi3) {
                     if (auto&& unresolvedYamlBody = yamlCall.maybeGet<YamlMap<>>("requestBody")) {
-                        const ContextOverlay _inContext(*this, {"(requestBody)", OnlyIn, &call});
+                        const ContextOverlay _inContext(*this,
+                                                        {Symbol("(requestBody)"), OnlyIn, &call});
 
                         if (call.verb == "get" || call.verb == "head" || call.verb == "delete")
-                            clog << logOffset() << unresolvedYamlBody.location()
-                                 << ": warning: RFC7231 does not allow requestBody in '"
-                                 << call.verb << "' operations\n";
+                            warningLog() << logOffset() << unresolvedYamlBody.location()
+                                         << ": warning: RFC7231 does not allow requestBody in '"
+                                         << call.verb << "' operations";
 
                         const auto& yamlBody = unresolvedYamlBody->resolveRef();
                         // Only one content type in requestBody is supported
@@ -656,14 +761,14 @@ const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
                 for (const auto& yamlParam : yamlParams | resolveRefs) {
                     const auto& name = yamlParam.get<string>("name");
 
-                    const ContextOverlay _inContext(*this, {name, OnlyIn, &call});
+                    const ContextOverlay _inContext(*this, {Symbol(name), OnlyIn, &call});
 
                     auto&& in = yamlParam.get<string>("in");
                     auto required = yamlParam.get<bool>("required", false);
                     if (!required && in == "path") {
-                        cout << logOffset() << yamlParam.location() << ": warning: '" << name
-                             << "' is in path but has no 'required' attribute"
-                                " - treating as required anyway\n";
+                        warningLog() << logOffset() << yamlParam.location() << ": warning: '"
+                                     << name << "' is in path but has no 'required' attribute"
+                                        " - treating as required anyway";
                         required = true;
                     }
 
@@ -687,7 +792,8 @@ const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
                     if (responseCode.starts_with('2')) {
                         // Only handling the first 2xx response for now
                         Response response{responseCode, responseData.get<string>("description")};
-                        const ContextOverlay _outContext(*this, {responseCode, OnlyOut, &call});
+                        const ContextOverlay _outContext(*this,
+                                                         {Symbol(responseCode), OnlyOut, &call});
                         for (const auto& [headerName, headerYaml] :
                              responseData.maybeGet<YamlMap<YamlMap<>>>("headers") | resolveRefs)
                             addVarDecl(response.headers,
@@ -706,10 +812,10 @@ const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
                                         response.body = analyzeBody(
                                             contentTypeYaml, response.description, contentType);
                                     else
-                                        clog << logOffset() << contentTypeYaml.location()
-                                             << ": warning: No support for more than one non-empty "
-                                                "content schema, subsequent schemas will be "
-                                                "skipped\n";
+                                        warningLog() << logOffset() << contentTypeYaml.location()
+                                                     << ": warning: No support for more than one "
+                                                        "non-empty content schema, subsequent "
+                                                        "schemas will be skipped";
                                 }
                             }
                         } else {
@@ -728,9 +834,9 @@ const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
                                     [](const Response& r) {
                                         return r.code.starts_with('2') || r.code.starts_with('3');
                                     }))
-                    clog << logOffset() << yamlResponses.location()
-                         << ": warning: all responses seem to describe errors - possibly "
-                            "incomplete API description\n";
+                    warningLog() << logOffset() << yamlResponses.location()
+                                 << ": warning: all responses seem to describe errors - possibly "
+                                    "incomplete API description";
             }
         } catch (ModelException& me) {
             throw YamlException(yaml_path.first, me.message);
@@ -741,13 +847,45 @@ const Model& Analyzer::loadModel(const string& filePath, InOut inOut)
 Analyzer::ImportedSchemaData Analyzer::loadSchemaFromRef(string_view refPath, bool preferInlining)
 {
     const auto& fullPath = context().fileDir / refPath;
-    const auto stem = makeModelKey(fullPath);
-    const auto [mIt, unseen] = _allModels.try_emplace(stem);
-    auto& model = mIt->second;
+    const auto stem = makeModelKey(_translator, fullPath);
+    if (currentModel().apiSpec == ApiSpec::JSONSchema) {
+        // A schema may $ref the same file many times; the inlining preferences of all those
+        // $ref's are combined the same way as in useForAllRoles()
+        auto& dependencies = currentModel().dataDependencies;
+        if (const auto it = ranges::find(dependencies, stem.string(), &pair<string, bool>::first);
+            it != dependencies.end())
+            it->second = it->second && preferInlining;
+        else
+            dependencies.emplace_back(stem.string(), preferInlining);
+    }
+    const Profiler::Scope _profilerScope(Profiler::Analysis, stem.string());
+    const ModelLock modelLock(stem.string());
+    auto& model = modelLock.model();
+    const auto unseen = modelLock.unseen();
+    const auto cloneMainSchema = [&model] {
+        auto clone = model.globalSchemas.back().first->cloneForInlining();
+        clone.role = model.roleOf(clone);
+        return clone;
+    };
 
     // If there is a matching model just return it
     auto modelRole = InAndOut;
-    if (!unseen) {
+    bool analysed = false;
+    if (model.evicted) {
+        // Only the main type is left from the model; inlining it or using it in another role
+        // needs the full model, which can only be loaded again
+        if ((model.role == InAndOut || model.role == currentRole()) && !model.evictedInlined
+            && !preferInlining) {
+            Stats::add("models", "reused");
+            return {model.evictedType, stem};
+        }
+        warningLog() << logOffset() << "Warning: the model for " << refPath
+                     << " has already been rendered but will be reloaded again";
+        Stats::add("models", "reloaded");
+        // The reloaded model is rendered over the evicted one, so it must cover its role too
+        modelRole = model.role == currentRole() ? model.role : InAndOut;
+        model.clear();
+    } else if (!unseen) {
         if (model.apiSpec != ApiSpec::JSONSchema)
             throw Exception(
                 string("Dependency model for ")
@@ -759,59 +897,89 @@ Analyzer::ImportedSchemaData Analyzer::loadSchemaFromRef(string_view refPath, bo
 
         if (!model.globalSchemas.empty()) {
             const auto& mainSchema = model.globalSchemas.back().first;
-            modelRole = mainSchema->role;
-            if (modelRole == InAndOut || modelRole == currentRole()) {
-                cout << logOffset() << "Reusing already loaded model for " << refPath
-                     << " with role " << modelRole << '\n';
+            if (model.role == InAndOut || model.role == currentRole()) {
+                Stats::add("models", "reused");
+                if (auto msg = debugLog())
+                    msg << logOffset() << "Reusing already loaded model for " << refPath
+                        << " with role " << model.role;
                 if (!mainSchema->inlined()) {
                     if (!preferInlining)
                         return {model.globalSchemas.back().second, stem};
-                    cout << logOffset() << "Forced inlining of schema " << mainSchema
-                         << " $ref'ed as " << refPath << '\n';
+                    if (auto msg = debugLog())
+                        msg << logOffset() << "Forced inlining of schema " << mainSchema
+                            << " $ref'ed as " << refPath;
                 }
-                return {mainSchema->cloneForInlining(), stem, model.globalSchemas.size() > 1};
+                return {cloneMainSchema(), stem, model.globalSchemas.size() > 1};
             }
-            cout << logOffset()
-                 << "Found existing data model generated for role " << modelRole
-                 << "; the model will be reloaded for all roles\n";
-            modelRole = InAndOut;
-            model.clear();
+            if (auto msg = debugLog())
+                msg << logOffset() << "Found existing data model generated for role " << model.role
+                    << "; the model will be used for all roles";
+            useForAllRoles(model);
+            Stats::add("models", "extended to all roles");
+            analysed = true;
         } else {
-            cout << logOffset() << "Warning: empty data model for " << refPath
-                 << " has been found in the cache; reloading\n";
+            warningLog() << logOffset() << "Warning: empty data model for " << refPath
+                         << " has been found in the cache; reloading";
             modelRole = currentRole();
         }
     }
 
-    cout << logOffset() << "Loading data schema from " << refPath
-         << " with role " << modelRole << '\n';
-    const auto yaml =
-        YamlNode::fromFile(_baseDir / fullPath, _translator.substitutions()).as<YamlMap<>>();
-    const ContextOverlay _modelContext(*this, fullPath.parent_path(), &model, modelRole);
-    auto tu = fillDataModel(model, yaml, stem.filename());
+    auto tu = model.globalSchemas.empty() ? TypeUsage() : model.globalSchemas.back().second;
+    if (!analysed) {
+        if (auto msg = debugLog())
+            msg << logOffset() << "Loading data schema from " << refPath
+                << " with role " << modelRole;
+        Stats::add("models", "analysed");
+        const auto yaml =
+            YamlNode::fromFile(_baseDir / fullPath, _translator.substitutions()).as<YamlMap<>>();
+        const ContextOverlay _modelContext(*this, fullPath.parent_path(), &model, modelRole);
+        model.role = modelRole;
+        tu = fillDataModel(model, yaml, stem.filename());
+    }
     const auto& mainSchema = model.globalSchemas.back().first;
     if (mainSchema->hasParents() && (!mainSchema->fields.empty() || mainSchema->hasAdditionalProperties())) {
-        cout << logOffset() << "Inlining suppressed due to model complexity\n";
+        if (auto msg = debugLog())
+            msg << logOffset() << "Inlining suppressed due to model complexity";
         return {tu, stem};
     }
     mainSchema->preferInlining = (unseen || mainSchema->preferInlining) && preferInlining;
     if (mainSchema->inlined()) {
-        cout << logOffset() << "The main schema from " << refPath;
-        if (mainSchema->trivial())
-            cout << " is trivial (see the mapping above) and";
-        cout << " will be inlined\n";
+        if (auto msg = debugLog()) {
+            msg << logOffset() << "The main schema from " << refPath;
+            if (mainSchema->trivial())
+                msg << " is trivial (see the mapping above) and";
+            msg << " will be inlined";
+        }
 
         currentModel().imports.insert(model.imports.begin(), model.imports.end());
-        return {mainSchema->cloneForInlining(), stem, model.globalSchemas.size() > 1};
+        return {cloneMainSchema(), stem, model.globalSchemas.size() > 1};
     }
     return {tu, stem};
 }
 
+void Analyzer::useForAllRoles(Model& model)
+{
+    model.role = InAndOut;
+    // Models $ref'ed from this one are now needed for all roles too; when such a model
+    // used to be analysed again, its inlining preference was combined with the $ref's one
+    for (const auto& [dependencyKey, preferInlining] : model.dataDependencies) {
+        const ModelLock dependencyLock(dependencyKey);
+        auto& dependency = dependencyLock.model();
+        if (dependency.role == InAndOut || dependency.globalSchemas.empty())
+            continue;
+        const auto& mainSchema = dependency.globalSchemas.back().first;
+        if (!mainSchema->hasParents()
+            || (mainSchema->fields.empty() && !mainSchema->hasAdditionalProperties()))
+            mainSchema->preferInlining = mainSchema->preferInlining && preferInlining;
+        useForAllRoles(dependency);
+    }
+}
+
 TypeUsage Analyzer::fillDataModel(Model& m, const YamlMap<>& yaml, const fs::path& filename)
 {
     m.apiSpec = ApiSpec::JSONSchema;
     auto&& s = analyzeSchema(yaml);
     if (s.name.empty())
-        s.name = titleCased(filename.string());
+        s.name = Symbol(titleCased(filename.string()));
     return addSchema(std::move(s));
 }
@@ -23,8 +23,11 @@
 #include "util.h"
 #include "yaml.h"
 
+#include <condition_variable>
 #include <filesystem>
+#include <mutex>
 #include <optional>
+#include <thread>
 
 class Analyzer {
 public:
@@ -42,12 +45,36 @@ public:
     void operator=(Analyzer&) = delete;
     void operator=(Analyzer&&) = delete;
 
+    [[nodiscard]] const fspath& baseDir() const { return _baseDir; }
+    //! The key in allModels() for the model loaded from \p sourcePath relative to the base directory
+    [[nodiscard]] static fspath makeModelKey(const Translator& translator,
+                                             const fspath& sourcePath);
     const Model& loadModel(const string& filePath, InOut inOut);
+    //! \brief All models loaded so far, by all Analyzer instances
+    //! \note Only safe to use once no Analyzer is loading models anymore
     static const models_t& allModels() { return _allModels; }
+    //! \brief Free the memory taken by a model that has been rendered, see Model::evict()
+    //! \note Only safe to use while no Analyzer is loading models
+    static void evictModel(const string& modelKey);
 
 private:
     static models_t _allModels;
 
+    // Several Analyzer instances may load models in parallel threads. At any moment each
+    // model in _allModels is either free or owned by exactly one thread that analyses or
+    // inspects it; other threads wait until the model is released (see ModelLock).
+    struct ModelOwner {
+        std::thread::id threadId;
+        size_t depth = 0; //!< ModelLock is reentrant for the owning thread
+    };
+    //! Guards _allModels, _modelOwners and _awaitedModels
+    static std::mutex _modelsMutex;
+    static std::condition_variable _modelReleased;
+    static std::unordered_map<string, ModelOwner> _modelOwners;
+    //! Which model each blocked thread waits for; used to detect deadlocks
+    static std::unordered_map<std::thread::id, string> _awaitedModels;
+    class ModelLock; // defined in analyzer.cpp
+
     const fspath _baseDir;
     const Translator& _translator;
 
@@ -74,7 +101,6 @@ private:
     [[nodiscard]] InOut currentRole() const { return currentScope().role; }
     [[nodiscard]] const Call* currentCall() const { return currentScope().call; }
 
-    [[nodiscard]] fspath makeModelKey(const fspath& sourcePath);
 
     struct ImportedSchemaData {
         std::variant<TypeUsage, ObjectSchema> schema;
@@ -84,6 +110,7 @@ private:
     [[nodiscard]] ImportedSchemaData loadSchemaFromRef(std::string_view refPath,
                                                        bool preferInlining = false);
     TypeUsage fillDataModel(Model& m, const YamlMap<>& yaml, const fspath& filename);
+    static void useForAllRoles(Model& model);
 
     [[nodiscard]] TypeUsage analyzeTypeUsage(const YamlMap<>& node);
     TypeUsage addSchema(ObjectSchema&& schema);
@@ -94,7 +121,7 @@ private:
     [[nodiscard]] ObjectSchema analyzeObject(const YamlMap<>& yamlSchema,
                                              RefsStrategy refsStrategy);
 
-    Body analyzeBody(const YamlMap<>& contentYaml, string description,
+    Body analyzeBody(const YamlMap<>& contentYaml, SharedText description,
                      const string& contentType = {}, bool required = false,
                      std::string_view name = "data");
 
@@ -103,13 +130,14 @@ private:
     [[nodiscard]] ObjectSchema
     makeTrivialSchema(TypeUsage&& tu, std::optional<std::string> maybeDescription = {}) const;
     [[nodiscard]] std::optional<VarDecl> makeVarDecl(TypeUsage type, std::string_view baseName,
-                                                     const Identifier& scope, string description,
+                                                     const Identifier& scope,
+                                                     SharedText description,
                                                      bool required = false,
                                                      string defaultValue = {}) const;
 
     void addVarDecl(VarDecls& varList, VarDecl&& v) const;
     void addVarDecl(VarDecls& varList, TypeUsage type, const string& baseName,
-                    const Identifier& scope, string description,
+                    const Identifier& scope, SharedText description,
                     bool required = false, string defaultValue = {}) const;
 
     [[nodiscard]] auto logOffset() const { return string(_indent * 2, ' '); }
@@ -0,0 +1,228 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "dependencies.h"
+
+#include "analyzer.h"
+#include "log.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "translator.h"
+#include "yaml.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <unordered_set>
+
+using namespace std;
+namespace fs = filesystem;
+
+namespace {
+
+//! Whether the value under the schema keyword \p key is literal data or an extension, never
+//! analysed as a schema
+bool isDataKey(const string& key)
+{
+    static const array<string_view, 5> DataKeys{"example", "examples", "default", "enum",
+                                                "const"};
+    return ranges::contains(DataKeys, key) || key.starts_with("x-");
+}
+
+//! Whether the value under \p key maps names (of properties, schemas, responses etc.) to objects
+bool isNamesMapKey(const string& key)
+{
+    static const array<string_view, 11> NamesMapKeys{
+        "properties", "patternProperties", "definitions", "$defs",   "schemas",  "parameters",
+        "responses",  "requestBodies",     "headers",     "content", "callbacks"};
+    return ranges::contains(NamesMapKeys, key);
+}
+
+/// \brief Collect $ref values pointing to other files (i.e. not starting with `#`)
+///
+/// $ref's inside examples, default values and other data that is not analysed are skipped.
+/// \param keysAreNames whether \p node maps names to objects (see isNamesMapKey()); such
+///                     names are never treated as keywords, even if they look like ones
+void collectExternalRefs(const YAML::Node& node, vector<string>& refPaths,
+                         bool keysAreNames = false)
+{
+    if (node.IsMap()) {
+        for (const auto& entry : node) {
+            if (keysAreNames || !entry.first.IsScalar()) {
+                collectExternalRefs(entry.second, refPaths);
+                continue;
+            }
+            const auto& key = entry.first.Scalar();
+            if (key == "$ref") {
+                if (entry.second.IsScalar() && !entry.second.Scalar().starts_with('#'))
+                    refPaths.emplace_back(entry.second.Scalar());
+            } else if (!isDataKey(key))
+                collectExternalRefs(entry.second, refPaths, isNamesMapKey(key));
+        }
+    } else if (node.IsSequence())
+        for (const auto& n : node)
+            collectExternalRefs(n, refPaths);
+}
+
+class RefsScanner {
+public:
+    RefsScanner(const Translator& translator, const DependencyGraph::files_t& knownFiles,
+                DependencyGraph::files_t& files)
+        : _translator(translator), _knownFiles(knownFiles), _files(files)
+    {}
+
+    /// \brief Scan \p sourcePath relative to \p baseDir, and files it refers to, recursively
+    ///
+    /// Files referring to each other are fine, as the analysis deals with that; files that
+    /// cannot be read or parsed are left with an empty hash - it's up to the analysis
+    /// to report errors in them, if it ever gets to loading them.
+    /// \return the path to the file, to look it up in the files map
+    string scan(const fs::path& baseDir, const fs::path& sourcePath)
+    {
+        auto filePath = DependencyGraph::filePath(baseDir, sourcePath);
+        auto modelKey = Analyzer::makeModelKey(_translator, sourcePath).string();
+        const auto [fileIt, unseen] = _files.try_emplace(filePath);
+        auto& file = fileIt->second; // Unordered map elements never move
+        if (!ranges::contains(file.modelKeys, modelKey))
+            file.modelKeys.emplace_back(std::move(modelKey));
+        if (!unseen)
+            return filePath; // Already scanned, or being scanned up the stack
+
+        if (!fs::is_regular_file(filePath)) {
+            debugLog() << "Could not find " << filePath << " to scan it for $ref's";
+            return filePath;
+        }
+        const auto hash = hashContents(readFile(filePath));
+        vector<fs::path> refSourcePaths;
+        if (const auto knownIt = _knownFiles.find(filePath);
+            knownIt != _knownFiles.end() && knownIt->second.hash == hash)
+            // The file hasn't changed; only the source paths are needed to recurse
+            for (const auto& refFilePath : knownIt->second.refs)
+                refSourcePaths.emplace_back(
+                    fs::path(refFilePath).lexically_relative(baseDir.lexically_normal()));
+        else {
+            vector<string> refPaths;
+            try {
+                collectExternalRefs(YamlNode::fromFile(filePath, _translator.substitutions()),
+                                    refPaths);
+            } catch (const Exception& e) {
+                debugLog() << "Could not scan " << filePath << " for $ref's: " << e.message;
+                return filePath;
+            }
+            // Not keeping the document until the analysis gets to it, as the scan goes
+            // through all files upfront
+            YamlNode::releaseFile(filePath);
+            for (const auto& refPath : refPaths)
+                // $refs mapped to types in the configuration are never loaded
+                if (_translator.mapReference(refPath).empty())
+                    refSourcePaths.emplace_back(
+                        (sourcePath.parent_path() / refPath).lexically_normal());
+        }
+
+        file.hash = hash;
+        for (const auto& refSourcePath : refSourcePaths)
+            if (auto refFilePath = scan(baseDir, refSourcePath);
+                !ranges::contains(file.refs, refFilePath))
+                file.refs.emplace_back(std::move(refFilePath));
+        return filePath;
+    }
+
+private:
+    const Translator& _translator;
+    const DependencyGraph::files_t& _knownFiles;
+    DependencyGraph::files_t& _files;
+};
+
+} // namespace
+
+string DependencyGraph::filePath(const fs::path& baseDir, const fs::path& sourcePath)
+{
+    return (baseDir / sourcePath).lexically_normal().string();
+}
+
+DependencyGraph::DependencyGraph(const Translator& translator, const inputs_t& inputs,
+                                 const files_t& knownFiles)
+{
+    const Profiler::Scope _profilerScope(Profiler::Scheduling);
+    RefsScanner scanner(translator, knownFiles, _files);
+    // Each file with the index of the first input that depends on it
+    unordered_map<string, size_t> owners;
+    vector<size_t> inputWaves(inputs.size());
+    // Inputs sharing files are joined into components, see Component
+    vector<size_t> componentRoots(inputs.size());
+    iota(componentRoots.begin(), componentRoots.end(), 0);
+    const auto findRoot = [&componentRoots](size_t i) {
+        while (componentRoots[i] != i)
+            i = componentRoots[i] = componentRoots[componentRoots[i]];
+        return i;
+    };
+    vector<unordered_set<string>> inputFiles(inputs.size());
+    // Inputs depending on files that could not be scanned may load any other files; so they
+    // are analysed after all other inputs, one at a time
+    vector<size_t> unscannedInputs;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const auto& [baseDir, fileName] = inputs[i];
+        auto& reached = inputFiles[i];
+        vector<string> pending{scanner.scan(baseDir, fileName)};
+        reached.insert(pending.front());
+        while (!pending.empty()) {
+            const auto filePath = std::move(pending.back());
+            pending.pop_back();
+            for (const auto& refFilePath : _files.at(filePath).refs)
+                if (reached.insert(refFilePath).second)
+                    pending.push_back(refFilePath);
+        }
+        if (ranges::any_of(reached,
+                           [this](const string& f) { return _files.at(f).hash.empty(); })) {
+            unscannedInputs.push_back(i);
+            continue;
+        }
+
+        // Schedule the input to the wave after all inputs that have loaded any of its files
+        size_t wave = 0;
+        for (const auto& filePath : reached)
+            if (const auto [ownerIt, unowned] = owners.try_emplace(filePath, i);
+                !unowned && ownerIt->second != i) {
+                wave = max(wave, inputWaves[ownerIt->second] + 1);
+                componentRoots[findRoot(i)] = findRoot(ownerIt->second);
+            }
+        inputWaves[i] = wave;
+        if (wave >= _waves.size())
+            _waves.resize(wave + 1);
+        _waves[wave].push_back(i);
+    }
+    for (const auto i : unscannedInputs) {
+        for (const auto& filePath : inputFiles[i])
+            if (const auto ownerIt = owners.find(filePath); ownerIt != owners.end())
+                componentRoots[findRoot(i)] = findRoot(ownerIt->second);
+        _waves.push_back({i});
+    }
+
+    unordered_map<size_t, size_t> componentIndices; // By the root input
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const auto [it, isNew] = componentIndices.try_emplace(findRoot(i), _components.size());
+        if (isNew)
+            _components.emplace_back();
+        auto& component = _components[it->second];
+        component.inputs.push_back(i);
+        for (const auto& filePath : inputFiles[i])
+            if (!ranges::contains(component.files, filePath))
+                component.files.push_back(filePath);
+    }
+}
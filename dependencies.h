@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Translator;
+
+/// \brief Schedule of input files analysis based on $ref dependencies between them
+///
+/// Upon construction, all input files and the files they refer to (directly or transitively)
+/// are scanned for $ref's to other files. Inputs depending on files that could not be scanned
+/// are scheduled after all others, each in a separate wave.
+/// Each referred file is then attributed to the first input (in the original order) that
+/// depends on it: this input is expected to load it, while all other inputs depending on
+/// that file are scheduled to a later wave. Inputs in the same wave share no files that
+/// could be loaded in that wave, so they can be analysed in parallel without waiting for
+/// each other; and every file is still loaded in the same order as in sequential processing.
+class DependencyGraph {
+public:
+    /// Input files, as pairs of a base directory and a file path relative to it
+    using inputs_t = std::vector<std::pair<std::filesystem::path, std::string>>;
+
+    struct File {
+        std::string hash; //!< See hashContents(); empty if the file could not be scanned
+        std::vector<std::string> refs; //!< Paths to files $ref'ed from this one
+        /// \brief Keys of the models for this file in Analyzer::allModels()
+        ///
+        /// A file reached from several base directories is loaded into a separate model
+        /// for each of them.
+        std::vector<std::string> modelKeys;
+    };
+    /// Files by their paths (including the base directory)
+    using files_t = std::unordered_map<std::string, File>;
+
+    /// A group of inputs that share files, with all files they depend on
+    struct Component {
+        std::vector<size_t> inputs;
+        std::vector<std::string> files;
+    };
+
+    /// \param knownFiles files from a previous run; $ref's of those that have not changed
+    ///                   since then are taken from here instead of scanning the files again
+    DependencyGraph(const Translator& translator, const inputs_t& inputs,
+                    const files_t& knownFiles = {});
+
+    /// The path identifying a file in files()
+    [[nodiscard]] static std::string filePath(const std::filesystem::path& baseDir,
+                                              const std::filesystem::path& sourcePath);
+
+    [[nodiscard]] const files_t& files() const { return _files; }
+    /// Indices of inputs, grouped into waves to be analysed one after another
+    [[nodiscard]] const std::vector<std::vector<size_t>>& waves() const { return _waves; }
+    /// \brief Inputs that can be analysed independently of each other
+    ///
+    /// The way a file shared by several inputs is analysed depends on all of them; inputs from
+    /// different components share no files, so the results for one of them don't depend on
+    /// whether the others have been analysed.
+    [[nodiscard]] const std::vector<Component>& components() const { return _components; }
+
+private:
+    files_t _files;
+    std::vector<std::vector<size_t>> _waves;
+    std::vector<Component> _components;
+};
@@ -0,0 +1,39 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "log.h"
+
+#include <mutex>
+
+using namespace std;
+
+LogMessage::~LogMessage()
+{
+    if (!_buffer)
+        return;
+
+    _buffer->put('\n');
+    const auto text = _buffer->view();
+    static mutex sinkMutex;
+    const lock_guard lock(sinkMutex);
+    // Keep the order of messages when stdout is buffered while stderr is not
+    if (&_sink != &cout)
+        cout.flush();
+    _sink.write(text.data(), ssize(text));
+}
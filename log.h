@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#pragma once
+
+#include <iostream>
+#include <optional>
+#include <sstream>
+
+enum class Verbosity { Quiet = 0, Basic, Debug };
+
+/// \brief A single console message, only formatted if it is going to be shown
+///
+/// The message is accumulated in a buffer and written out as a whole, followed by a newline,
+/// when the object is destroyed; this way messages from different threads don't interleave,
+/// and the console is not flushed on every line. Everything streamed into a disabled message
+/// is ignored; to avoid even evaluating the parts of the message, check it first:
+/// \code
+/// if (auto msg = debugLog())
+///     msg << node.location() << ": something happened";
+/// \endcode
+class LogMessage {
+public:
+    LogMessage(Verbosity level, std::ostream& sink) : _sink(sink)
+    {
+        if (enabled(level))
+            _buffer.emplace();
+    }
+    ~LogMessage();
+    LogMessage(const LogMessage&) = delete;
+    LogMessage& operator=(const LogMessage&) = delete;
+
+    /// Set the verbosity for all subsequent messages; not thread-safe, call it before
+    /// spawning any threads
+    static void setVerbosity(Verbosity verbosity) { _verbosity = verbosity; }
+    [[nodiscard]] static bool enabled(Verbosity level) { return level <= _verbosity; }
+
+    explicit operator bool() const { return _buffer.has_value(); }
+
+    template <typename T>
+    LogMessage& operator<<(const T& value)
+    {
+        if (_buffer)
+            *_buffer << value;
+        return *this;
+    }
+
+private:
+    static inline Verbosity _verbosity = Verbosity::Basic;
+
+    std::ostream& _sink;
+    std::optional<std::ostringstream> _buffer;
+};
+
+//! Progress messages shown unless --messages quiet is passed
+[[nodiscard]] inline LogMessage infoLog() { return {Verbosity::Basic, std::cout}; }
+//! Detailed messages only shown with --messages debug
+[[nodiscard]] inline LogMessage debugLog() { return {Verbosity::Debug, std::cout}; }
+//! Warnings about the input, shown unless --messages quiet is passed
+[[nodiscard]] inline LogMessage warningLog() { return {Verbosity::Basic, std::clog}; }
+//! Errors, shown at any verbosity
+[[nodiscard]] inline LogMessage errorLog() { return {Verbosity::Quiet, std::cerr}; }
@@ -17,14 +17,24 @@
  */
 
 #include "analyzer.h"
+#include "dependencies.h"
+#include "log.h"
+#include "manifest.h"
 #include "printer.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "stats.h"
 #include "translator.h"
+#include "yaml.h"
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QCommandLineParser>
 
+#include <atomic>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 int main(int argc, char* argv[])
 {
@@ -49,6 +59,12 @@ int main(int argc, char* argv[])
         "outputdir");
     parser.addOption(outputDirOption);
 
+    QCommandLineOption configSnapshotOption("config-snapshot",
+        QCoreApplication::translate("main",
+            "Cache the resolved configuration in <snapshotfile> to speed up subsequent runs"),
+        "snapshotfile");
+    parser.addOption(configSnapshotOption);
+
     QCommandLineOption schemaRoleOption("role",
         QCoreApplication::translate("main",
             "For JSON Schema, generate code assuming <role>, one of:"
@@ -62,6 +78,48 @@ int main(int argc, char* argv[])
         "verbosity", "basic");
     parser.addOption(messagesRoleOption);
 
+    QCommandLineOption noIncrementalOption("no-incremental",
+        QCoreApplication::translate("main",
+            "Analyze and render all input files, even those unchanged since the previous run"));
+    parser.addOption(noIncrementalOption);
+
+    QCommandLineOption jobsOption("jobs",
+        QCoreApplication::translate("main",
+            "Analyze up to <n> input files in parallel; 0 means as many as there are"
+            " CPU cores (the default is 1, that is, no parallelism)"),
+        "n", "1");
+    parser.addOption(jobsOption);
+
+    QCommandLineOption profileOption("profile",
+        QCoreApplication::translate("main",
+            "Measure the time spent in each phase of generation and print a summary at exit"));
+    parser.addOption(profileOption);
+
+    QCommandLineOption perfCountersOption("perf-counters",
+        QCoreApplication::translate("main",
+            "Same as --profile, and also collect hardware performance counters for each phase"
+            " (Linux only)"));
+    parser.addOption(perfCountersOption);
+
+    QCommandLineOption traceOutOption("trace-out",
+        QCoreApplication::translate("main",
+            "Record the analysis and rendering of each file and save it to <tracefile>"
+            " in Chrome trace event format (viewable in Perfetto or chrome://tracing)"),
+        "tracefile");
+    parser.addOption(traceOutOption);
+
+    QCommandLineOption statsOption("stats",
+        QCoreApplication::translate("main",
+            "Count regex evaluations, type map lookups, reused models and other events on hot"
+            " paths, and print the counters at exit"));
+    parser.addOption(statsOption);
+
+    QCommandLineOption statsJsonOption("stats-json",
+        QCoreApplication::translate("main",
+            "Same as --stats but save the counters to <statsfile> in JSON instead of printing"),
+        "statsfile");
+    parser.addOption(statsJsonOption);
+
     parser.addPositionalArgument("files",
         QCoreApplication::translate("main",
             "Files or directories with API definition in Swagger format."
@@ -78,9 +136,20 @@ int main(int argc, char* argv[])
         const auto verbosity = verbosityArg == "quiet"   ? Verbosity::Quiet
                                : verbosityArg == "debug" ? Verbosity::Debug
                                                          : Verbosity::Basic;
+        LogMessage::setVerbosity(verbosity);
+        if (parser.isSet(perfCountersOption))
+            Profiler::enableCounters();
+        else if (parser.isSet(profileOption))
+            Profiler::enable();
+        const auto traceFilePath = parser.value(traceOutOption).toStdString();
+        if (!traceFilePath.empty())
+            Profiler::enableTrace();
+        const auto statsFilePath = parser.value(statsJsonOption).toStdString();
+        if (parser.isSet(statsOption) || !statsFilePath.empty())
+            Stats::enable();
         Translator translator {parser.value(configPathOption).toStdString(),
                                parser.value(outputDirOption).toStdString(),
-                               verbosity};
+                               parser.value(configSnapshotOption).toStdString()};
 
         vector<fs::path> paths, exclusions;
         const auto& pathArgs = parser.positionalArguments();
@@ -94,15 +163,15 @@ int main(int argc, char* argv[])
         const auto role =
             roleValue == "i" ? OnlyIn : roleValue == "o" ? OnlyOut : InAndOut;
 
+        DependencyGraph::inputs_t inputs;
         for(const auto& path: paths) {
             auto ftype = fs::status(path).type();
             if (ftype == fs::file_type::regular)
-                Analyzer{translator, path.parent_path()}.loadModel(path.filename().string(), role);
+                inputs.emplace_back(path.parent_path(), path.filename().string());
 
             if (ftype != fs::file_type::directory)
                 continue;
 
-            Analyzer a{translator, path};
             for (const auto& f :
                  fs::directory_iterator(path, fs::directory_options::skip_permission_denied))
             {
@@ -110,7 +179,7 @@ int main(int argc, char* argv[])
                     continue;
                 auto&& fName = f.path().filename();
                 if (ranges::find(exclusions, fName) == exclusions.cend())
-                    a.loadModel(fName.string(), role);
+                    inputs.emplace_back(path, fName.string());
             }
         }
 
@@ -123,10 +192,62 @@ int main(int argc, char* argv[])
         if (clangFormatArgs)
             clangFormatCommand += clangFormatArgs;
 
+        // Files that have not changed since the previous run with the same settings and
+        // templates don't need to be analysed and rendered again; without knowing which build
+        // of GTAD generated them, nothing can be reused
+        const auto manifestPath = translator.outputBaseDir() / ".gtad-manifest";
+        const auto useManifest = !translator.outputBaseDir().empty() && !generatorKey().empty();
+        auto previousRun = useManifest && !parser.isSet(noIncrementalOption)
+                               ? Manifest::load(manifestPath)
+                               : Manifest();
+        // The outputs also depend on how they are formatted; e.g., after a dry run of
+        // clang-format they have to be formatted anew
+        Manifest thisRun(generatorKey() + '/' + roleValue.toStdString() + '/'
+                         + translator.configKey() + '/' + clangFormatCommand);
+        if (previousRun.settingsKey != thisRun.settingsKey || previousRun.templatesChanged())
+            previousRun = {};
+
+        const DependencyGraph dependencies(translator, inputs, previousRun.files);
+        thisRun.files = dependencies.files();
+        thisRun.templateHashes = previousRun.templateHashes;
+        vector<bool> toAnalyse(inputs.size(), true);
+        size_t skippedCounter = 0;
+        // Models to be generated, with indices of the respective units in thisRun
+        unordered_map<string, size_t> modelUnits;
+        for (const auto& component : dependencies.components()) {
+            auto& unit = thisRun.units.emplace_back();
+            for (const auto i : component.inputs)
+                unit.inputs.emplace_back(
+                    DependencyGraph::filePath(inputs[i].first, inputs[i].second));
+            ranges::sort(unit.inputs);
+            if (const auto* previousUnit =
+                    previousRun.findUnchanged(unit.inputs, component, dependencies.files())) {
+                unit.outputs = previousUnit->outputs;
+                for (const auto& fName : unit.outputs)
+                    translator.printer().listOutFile(fName);
+                for (const auto i : component.inputs)
+                    toAnalyse[i] = false;
+                skippedCounter += component.inputs.size();
+            } else
+                for (const auto& filePath : component.files)
+                    for (const auto& modelKey : dependencies.files().at(filePath).modelKeys)
+                        modelUnits.emplace(modelKey, thisRun.units.size() - 1);
+        }
+        if (skippedCounter > 0)
+            infoLog() << "Skipping " << skippedCounter
+                      << " input file(s) unchanged since the previous run";
+        debugLog() << "Scheduled " << inputs.size() - skippedCounter << " input file(s) in "
+                   << dependencies.waves().size() << " wave(s)";
+
+        auto jobs = parser.value(jobsOption).toUInt();
+        if (jobs == 0)
+            jobs = max(thread::hardware_concurrency(), 1U);
+
         size_t filesCounter = 0;
-        for (const auto& [stem, model]: Analyzer::allModels()) {
-            if (model.empty() || model.trivial())
-                continue;
+        bool manifestComplete = true;
+        const auto printModel = [&](const string& stem, const Model& model) {
+            if (model.empty() || model.trivial() || model.evicted)
+                return;
 
             const auto targetDir = fs::path(stem).parent_path();
             fs::create_directories(targetDir);
@@ -138,9 +259,109 @@ int main(int argc, char* argv[])
             for (const auto& fName : fileNames)
                 clangFormatCommand += ' ' + fName;
             filesCounter += fileNames.size();
+            if (const auto unitIt = modelUnits.find(stem); unitIt != modelUnits.end())
+                ranges::copy(fileNames, back_inserter(thisRun.units[unitIt->second].outputs));
+            else
+                manifestComplete = false;
+        };
+
+        // Models of a component are complete once the last wave with its inputs is analysed;
+        // they are rendered and evicted right away, instead of keeping all models until the end
+        vector<vector<size_t>> componentsDoneByWave(dependencies.waves().size());
+        {
+            vector<size_t> waveOfInput(inputs.size());
+            for (size_t w = 0; w < dependencies.waves().size(); ++w)
+                for (const auto i : dependencies.waves()[w])
+                    waveOfInput[i] = w;
+            for (size_t c = 0; c < dependencies.components().size(); ++c) {
+                const auto& componentInputs = dependencies.components()[c].inputs;
+                if (componentInputs.empty() || !toAnalyse[componentInputs.front()])
+                    continue; // Unchanged since the previous run
+                size_t lastWave = 0;
+                for (const auto i : componentInputs)
+                    lastWave = max(lastWave, waveOfInput[i]);
+                componentsDoneByWave[lastWave].push_back(c);
+            }
         }
-        cout << "Formatting " << filesCounter << " files\n";
-        system(clangFormatCommand.c_str());
+
+        // Within each wave, workers take the next input from the list, reusing their Analyzers
+        // as long as the base directory stays the same
+        for (size_t w = 0; w < dependencies.waves().size(); ++w) {
+            vector<size_t> wave;
+            ranges::copy_if(dependencies.waves()[w], back_inserter(wave),
+                            [&toAnalyse](size_t i) { return toAnalyse[i]; });
+            atomic_size_t nextInput = 0;
+            exception_ptr firstError;
+            mutex firstErrorMutex;
+            const auto worker = [&] {
+                try {
+                    unique_ptr<Analyzer> analyzer;
+                    for (auto i = nextInput++; i < wave.size(); i = nextInput++) {
+                        const auto& [baseDir, fileName] = inputs[wave[i]];
+                        if (!analyzer || analyzer->baseDir() != baseDir)
+                            analyzer = make_unique<Analyzer>(translator, baseDir);
+                        analyzer->loadModel(fileName, role);
+                    }
+                } catch (...) {
+                    nextInput = wave.size(); // Stop the other workers
+                    const lock_guard lock(firstErrorMutex);
+                    if (!firstError)
+                        firstError = current_exception();
+                }
+            };
+            if (const auto waveJobs = min(jobs, unsigned(wave.size())); waveJobs <= 1)
+                worker();
+            else {
+                vector<jthread> workers;
+                workers.reserve(waveJobs);
+                for (auto j = 0U; j < waveJobs; ++j)
+                    workers.emplace_back(worker);
+            } // jthread joins on destruction
+            if (firstError)
+                rethrow_exception(firstError);
+
+            for (const auto c : componentsDoneByWave[w])
+                for (const auto& filePath : dependencies.components()[c].files) {
+                    for (const auto& modelKey : dependencies.files().at(filePath).modelKeys)
+                        if (const auto it = Analyzer::allModels().find(modelKey);
+                            it != Analyzer::allModels().end()) {
+                            printModel(it->first, it->second);
+                            Analyzer::evictModel(modelKey);
+                        }
+                    // No other component loads this file
+                    YamlNode::releaseFile(filePath);
+                }
+        }
+        YamlNode::releaseAllFiles();
+        // Normally, all models have been rendered by now; but just in case the dependency scan
+        // didn't see some $ref's the analysis followed, render whatever remains
+        for (const auto& [stem, model]: Analyzer::allModels())
+            printModel(stem, model);
+
+        if (!translator.outputBaseDir().empty()) {
+            for (const auto& templatePath : translator.printer().partialFiles())
+                thisRun.templateHashes[templatePath] = hashContents(readFile(templatePath));
+            // Without knowing where some outputs came from, the next run has to be a full one
+            if (error_code ec; !useManifest || !manifestComplete || !thisRun.save(manifestPath))
+                fs::remove(manifestPath, ec);
+        }
+
+        if (filesCounter > 0) {
+            infoLog() << "Formatting " << filesCounter << " files";
+            cout.flush(); // Before clang-format gets to write anything
+            const Profiler::Scope _profilerScope(Profiler::Formatting);
+            system(clangFormatCommand.c_str());
+        }
+
+        if (Profiler::enabled())
+            Profiler::report(cout);
+        if (!traceFilePath.empty() && !Profiler::writeTrace(traceFilePath))
+            errorLog() << "Could not write the trace to " << traceFilePath;
+        if (!statsFilePath.empty()) {
+            if (!Stats::writeJson(statsFilePath))
+                errorLog() << "Could not write the statistics to " << statsFilePath;
+        } else if (Stats::enabled())
+            Stats::report(cout);
     }
     catch (Exception& e)
     {
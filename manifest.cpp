@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "manifest.h"
+
+#include "log.h"
+#include "snapshot.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/// Bump this whenever the manifest layout changes
+constexpr auto ManifestVersion = 2;
+
+namespace {
+
+void saveStrings(SnapshotWriter& manifest, const vector<string>& strings)
+{
+    manifest.addNumber(strings.size());
+    for (const auto& s : strings)
+        manifest.addString(s);
+}
+
+vector<string> loadStrings(SnapshotReader& manifest)
+{
+    vector<string> result(manifest.takeNumber());
+    for (auto& s : result)
+        s = manifest.takeString();
+    return result;
+}
+
+} // namespace
+
+Manifest Manifest::load(const fspath& filePath)
+{
+    const MappedFile manifestFile(filePath);
+    if (manifestFile.contents().empty())
+        return {};
+
+    SnapshotReader reader(manifestFile.contents());
+    try {
+        if (reader.takeNumber() != ManifestVersion)
+            return {};
+        Manifest result(reader.takeString());
+        for (auto count = reader.takeNumber(); count > 0; --count) {
+            auto templatePath = reader.takeString();
+            result.templateHashes.emplace(std::move(templatePath), reader.takeString());
+        }
+        for (auto count = reader.takeNumber(); count > 0; --count) {
+            auto& file = result.files[reader.takeString()];
+            file.hash = reader.takeString();
+            file.refs = loadStrings(reader);
+            file.modelKeys = loadStrings(reader);
+        }
+        for (auto count = reader.takeNumber(); count > 0; --count) {
+            auto& unit = result.units.emplace_back();
+            unit.inputs = loadStrings(reader);
+            unit.outputs = loadStrings(reader);
+        }
+        if (!reader.atEnd())
+            throw Exception("Unexpected data at the end of the manifest");
+        return result;
+    } catch (const Exception& e) {
+        warningLog() << filePath << ": " << e.message << ", all files will be regenerated";
+    }
+    return {};
+}
+
+bool Manifest::save(const fspath& filePath) const
+{
+    SnapshotWriter writer;
+    writer.addNumber(ManifestVersion);
+    writer.addString(settingsKey);
+    writer.addNumber(templateHashes.size());
+    for (const auto& [templatePath, hash] : templateHashes) {
+        writer.addString(templatePath);
+        writer.addString(hash);
+    }
+    writer.addNumber(files.size());
+    for (const auto& [path, file] : files) {
+        writer.addString(path);
+        writer.addString(file.hash);
+        saveStrings(writer, file.refs);
+        saveStrings(writer, file.modelKeys);
+    }
+    writer.addNumber(units.size());
+    for (const auto& unit : units) {
+        saveStrings(writer, unit.inputs);
+        saveStrings(writer, unit.outputs);
+    }
+    return writer.saveTo(filePath);
+}
+
+bool Manifest::templatesChanged() const
+{
+    return ranges::any_of(templateHashes, [](const auto& entry) {
+        const auto& [templatePath, hash] = entry;
+        return !filesystem::exists(templatePath) || hashContents(readFile(templatePath)) != hash;
+    });
+}
+
+const Manifest::Unit* Manifest::findUnchanged(const vector<string>& inputs,
+                                              const DependencyGraph::Component& component,
+                                              const DependencyGraph::files_t& currentFiles) const
+{
+    const auto unitIt = ranges::find(units, inputs, &Unit::inputs);
+    if (unitIt == units.end())
+        return nullptr;
+    for (const auto& filePath : component.files)
+        if (const auto it = files.find(filePath);
+            it == files.end() || currentFiles.at(filePath).hash.empty()
+            || it->second.hash != currentFiles.at(filePath).hash)
+            return nullptr;
+    // Also regenerate the outputs if any of them has been removed
+    if (!ranges::all_of(unitIt->outputs, [](const string& f) { return filesystem::exists(f); }))
+        return nullptr;
+    return &*unitIt;
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#pragma once
+
+#include "dependencies.h"
+#include "util.h"
+
+/// \brief The record of a GTAD run, used to only regenerate what has changed since then
+///
+/// The manifest is stored in the output directory. It keeps the settings and templates
+/// the outputs have been generated with, the hashes and $ref's of all files analysed, and
+/// the outputs generated for each dependency graph component (see DependencyGraph::Component).
+/// As long as the settings and templates are the same, the next run only has to analyse
+/// and render the components whose files have changed.
+struct Manifest {
+    using fspath = std::filesystem::path;
+
+    /// Outputs generated for a dependency graph component
+    struct Unit {
+        std::vector<std::string> inputs; //!< Paths to the inputs of the component, sorted
+        std::vector<std::string> outputs;
+    };
+
+    /// \brief The GTAD build, the configuration file hash and the command-line options
+    ///        affecting the outputs
+    std::string settingsKey;
+    /// Hashes of template files loaded when rendering the outputs, by file path
+    string_map_t<std::string> templateHashes;
+    DependencyGraph::files_t files;
+    std::vector<Unit> units;
+
+    Manifest() = default;
+    explicit Manifest(std::string settingsKey) : settingsKey(std::move(settingsKey)) {}
+
+    /// \brief Load the manifest from \p filePath
+    /// \return the loaded manifest, or an empty one if the file is missing or damaged
+    [[nodiscard]] static Manifest load(const fspath& filePath);
+    bool save(const fspath& filePath) const;
+
+    /// \brief Check whether the templates have changed since this manifest was saved
+    [[nodiscard]] bool templatesChanged() const;
+
+    /// \brief Find the outputs of \p component if none of its files has changed since then
+    /// \return the unit with outputs for \p inputs; nullptr if the component must be regenerated
+    [[nodiscard]] const Unit* findUnchanged(const std::vector<std::string>& inputs,
+                                            const DependencyGraph::Component& component,
+                                            const DependencyGraph::files_t& currentFiles) const;
+};
@@ -3,10 +3,46 @@
 #include <algorithm>
 #include <format>
 #include <locale>
+#include <mutex>
 #include <ranges>
+#include <unordered_set>
+#include <utility>
 
 using namespace std;
 
+struct TypeDefinitionHash {
+    size_t operator()(const TypeDefinition& d) const
+    {
+        // Entries are combined in an order-independent way, as unordered_maps have no fixed order
+        const hash<string> h;
+        size_t result = h(d.importRenderer);
+        for (const auto& [k, v] : d.attributes)
+            result += h(k) * 31 + h(v);
+        for (const auto& [k, l] : d.lists) {
+            auto listHash = h(k);
+            for (const auto& v : l)
+                listHash = listHash * 31 + h(v);
+            result += listHash;
+        }
+        return result;
+    }
+};
+
+const TypeDefinition* TypeDefinition::intern(TypeDefinition&& definition)
+{
+    static mutex internedMutex;
+    static unordered_set<TypeDefinition, TypeDefinitionHash> interned;
+    const lock_guard l(internedMutex);
+    // unordered_set never moves its elements around, so the pointers remain valid
+    return &*interned.insert(std::move(definition)).first;
+}
+
+const TypeDefinition* TypeDefinition::defaultDefinition()
+{
+    static const auto* const d = intern({});
+    return d;
+}
+
 string Identifier::qualifiedName() const
 {
     return (call ? call->name + roleToChar(role) : "") + name;
@@ -20,8 +56,24 @@ void TypeUsage::assignName(string setName, string setBaseName)
 {
     if (!name.empty())
         throw ModelException("It's not allowed to overwrite used type name if it's already set");
-    name = std::move(setName);
-    baseName = setBaseName.empty() ? name : std::move(setBaseName);
+    name = Symbol(setName);
+    baseName = setBaseName.empty() ? name : Symbol(setBaseName);
+}
+
+void TypeUsage::setImportRenderer(string renderer)
+{
+    if (renderer == importRenderer())
+        return;
+    auto d = definition();
+    d.importRenderer = std::move(renderer);
+    setDefinition(std::move(d));
+}
+
+void TypeUsage::addImport(imports_type::value_type importName)
+{
+    auto d = definition();
+    d.lists["imports"].emplace_back(std::move(importName));
+    setDefinition(std::move(d));
 }
 
 TypeUsage TypeUsage::specialize(vector<TypeUsage>&& params) const
@@ -31,6 +83,18 @@ TypeUsage TypeUsage::specialize(vector<TypeUsage>&& params) const
     return tu;
 }
 
+size_t hash<TypeUsage>::operator()(const TypeUsage& tu) const
+{
+    // Names are symbols and definitions are interned, so hashing their addresses is enough
+    const hash<Symbol> h;
+    auto result = h(tu.name) * 31 + h(tu.baseName);
+    result = result * 31 + hash<const void*>{}(tu.call);
+    result = result * 31 + hash<const void*>{}(&tu.definition());
+    for (const auto& paramType : tu.paramTypes)
+        result = result * 31 + (*this)(paramType);
+    return result;
+}
+
 void toUpper(char& c) { c = toupper(c, locale::classic()); }
 
 string titleCased(string s)
@@ -61,6 +125,52 @@ string VarDecl::toString(bool withDefault) const
     return result;
 }
 
+const VarDecl* VarDecls::find(const Symbol& name) const
+{
+    const auto it = _index.find(name);
+    return it != _index.end() ? &_vars[it->second] : nullptr;
+}
+
+void VarDecls::push_back(VarDecl v)
+{
+    _index.try_emplace(v.name, _vars.size());
+    _vars.push_back(std::move(v));
+}
+
+optional<VarDecl> VarDecls::addOrReplace(VarDecl v)
+{
+    const auto [it, added] = _index.try_emplace(v.name, _vars.size());
+    if (added) {
+        _vars.push_back(std::move(v));
+        return {};
+    }
+    return exchange(_vars[it->second], std::move(v));
+}
+
+VarDecls::container_type VarDecls::release()
+{
+    _index.clear();
+    return std::move(_vars);
+}
+
+VarDeclsView& VarDeclsView::add(part_type vars)
+{
+    if (_partCount == MaxParts)
+        throw ModelException("Too many variable lists in a single view");
+    _parts[_partCount++] = vars;
+    return *this;
+}
+
+void VarDeclsView::const_iterator::settle()
+{
+    const size_t passCount = _view->_partitioned ? 2 : 1;
+    for (; _pass < passCount; ++_pass, _part = 0)
+        for (; _part < _view->_partCount; ++_part, _index = 0)
+            for (const auto& part = _view->_parts[_part]; _index < part.size(); ++_index)
+                if (!_view->_partitioned || part[_index].required == (_pass == 0))
+                    return;
+}
+
 Path::Path(string path)
     : string(std::move(path))
 {
@@ -106,57 +216,59 @@ Call::params_type& Call::getParamsBlock(const string& blockName)
     return params[getParamsBlockIndex(blockName)];
 }
 
-Call::params_type Call::collateParams() const
+VarDeclsView Call::collateParams() const
 {
-    params_type allCollated;
-    for (auto c: params)
-        allCollated.insert(allCollated.end(), c.begin(), c.end());
+    VarDeclsView allCollated;
+    for (const auto& c: params)
+        allCollated.add(c);
     dispatchVisit(
         body,
         [&allCollated](const FlatSchema& unpacked) {
-            allCollated.insert(allCollated.end(), unpacked.fields.begin(),
-                               unpacked.fields.end());
+            allCollated.add(unpacked.fields);
             if (unpacked.hasAdditionalProperties())
-                allCollated.emplace_back(unpacked.additionalProperties);
+                allCollated.add(unpacked.additionalProperties);
         },
         [&allCollated](const VarDecl& packed) {
-            allCollated.emplace_back(packed);
+            allCollated.add(packed);
         },
         [](monostate) {});
     return allCollated;
 }
 
+schema_ptr_t makeSchema(ObjectSchema&& schema, pmr::memory_resource* resource)
+{
+    return {pmr::polymorphic_allocator<>(resource).new_object<ObjectSchema>(std::move(schema)),
+            SchemaDeleter{resource}};
+}
+
 Call& Model::addCall(Path path, string verb, string operationId, bool deprecated, bool needsToken)
 {
     if (callClasses.empty())
         callClasses.emplace_back();
     auto& cc = callClasses.back();
-    cc.calls.emplace_back(std::move(path), std::move(verb),
-                          std::move(operationId), deprecated, needsToken);
-    return cc.calls.back();
+    auto& call = cc.calls.emplace_back(std::move(path), std::move(verb), std::move(operationId),
+                                       deprecated, needsToken);
+    _localScopes.emplace(&call, &call.localSchemas);
+    return call;
 }
 
 types_t& Model::typesForScope(const Call* s)
 {
     if (!s)
         return globalSchemas;
-    auto allScopes = views::transform(callClasses, &CallClass::calls) | views::join;
-    if (const auto scope = ranges::find(allScopes, s, [](const Call& c) { return &c; });
-        scope != allScopes.end())
-        return scope->localSchemas;
+    if (const auto scopeIt = _localScopes.find(s); scopeIt != _localScopes.end())
+        return *scopeIt->second;
     throw ModelException(format("Scope {} not found", s->name));
 }
 
 void Model::addSchema(ObjectSchema&& schema, const TypeUsage& tu)
 {
     auto& schemas = typesForScope(schema.call);
-    if (ranges::find_if(schemas, [&n = schema.name](
-                                     const types_t::value_type& s) { return s.first->name == n; })
-        != schemas.end())
+    if (!_schemaNames[schema.call].insert(schema.name).second)
         return;
 
     addImportsFrom(schema);
-    schemas.emplace_back(std::make_unique<const ObjectSchema>(std::move(schema)), tu);
+    schemas.emplace_back(makeSchema(std::move(schema), _arena.get()), tu);
 }
 
 void Model::addImportsFrom(const ObjectSchema& s)
@@ -176,12 +288,12 @@ void Model::addImportsFrom(const FlatSchema& s)
 
 void Model::addImportsFrom(const TypeUsage& type)
 {
-    const auto renderer = type.importRenderer;
-    const auto singleTypeImport = type.attributes.find("imports");
-    if (singleTypeImport != type.attributes.end())
+    const auto& renderer = type.importRenderer();
+    const auto singleTypeImport = type.attributes().find("imports");
+    if (singleTypeImport != type.attributes().end())
         imports.emplace(singleTypeImport->second, renderer);
-    const auto typeImportsIt = type.lists.find("imports");
-    if (typeImportsIt != type.lists.end())
+    const auto typeImportsIt = type.lists().find("imports");
+    if (typeImportsIt != type.lists().end())
         for (auto&& import : typeImportsIt->second)
             imports.emplace(import, renderer);
     for (const auto& paramType : type.paramTypes)
@@ -195,4 +307,32 @@ void Model::clear()
     globalSchemas.clear();
     defaultServers.clear();
     callClasses.clear();
+    _localScopes.clear();
+    _schemaNames.clear();
+    _arena->release();
+    role = InAndOut;
+    dataDependencies.clear();
+    evicted = false;
+    evictedType = {};
+    evictedInlined = false;
+}
+
+void Model::evict()
+{
+    if (!globalSchemas.empty()) {
+        const auto& [mainSchema, mainType] = globalSchemas.back();
+        evictedType = mainType;
+        evictedInlined = mainSchema->inlined();
+    }
+    // Swapping with empty containers actually frees the memory
+    types_t().swap(globalSchemas);
+    imports_type().swap(imports);
+    decltype(localRefs)().swap(localRefs);
+    decltype(defaultServers)().swap(defaultServers);
+    callClasses.clear();
+    decltype(_localScopes)().swap(_localScopes);
+    decltype(_schemaNames)().swap(_schemaNames);
+    decltype(dataDependencies)().swap(dataDependencies);
+    _arena->release();
+    evicted = true;
 }
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "symbol.h"
 #include "util.h"
 
 #include <QtCore/QUrl>
@@ -26,7 +27,11 @@
 #include <cstdint>
 #include <limits>
 #include <list>
+#include <memory_resource>
+#include <optional>
+#include <span>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 
 std::string titleCased(std::string s);
@@ -48,7 +53,7 @@ struct Call;
 struct Identifier
 {
     /// As transformed for the generated code, not what's in YAML
-    std::string name;
+    Symbol name;
     InOut role = InAndOut;
     /// Always empty for Calls as they cannot be scoped (as yet)
     const Call* call = nullptr;
@@ -60,19 +65,35 @@ struct Identifier
 
 struct ObjectSchema;
 
+/// \brief The part of a target type description shared by all its usages
+///
+/// Instances are interned (see intern()) and never change afterwards, so that TypeUsage objects
+/// can refer to them by a plain pointer and compare them by address.
+struct TypeDefinition
+{
+    std::unordered_map<std::string, std::string> attributes;
+    std::unordered_map<std::string, std::vector<std::string>> lists;
+    std::string importRenderer = "{{_}}";
+
+    [[nodiscard]] bool operator==(const TypeDefinition&) const = default;
+
+    /// Get the interned definition equal to \p definition; the result lives until the end of
+    /// the program
+    [[nodiscard]] static const TypeDefinition* intern(TypeDefinition&& definition);
+    /// The interned definition with no attributes and the default import renderer
+    [[nodiscard]] static const TypeDefinition* defaultDefinition();
+};
+
 struct TypeUsage : Identifier
 {
     using imports_type = std::vector<std::string>;
 
-    std::string baseName; ///< As used in the API definition
-    std::unordered_map<std::string, std::string> attributes;
-    std::unordered_map<std::string, std::vector<std::string>> lists;
+    Symbol baseName; ///< As used in the API definition
     std::vector<TypeUsage> paramTypes; ///< Parameter types for type templates
-    std::string importRenderer = "{{_}}";
 
     TypeUsage() = default;
     explicit TypeUsage(std::string typeName)
-        : Identifier {std::move(typeName)}
+        : Identifier {Symbol(typeName)}
     {}
     explicit TypeUsage(const ObjectSchema& schema);
     void assignName(std::string setName, std::string setBaseName = {});
@@ -81,49 +102,180 @@ struct TypeUsage : Identifier
 
     [[nodiscard]] bool empty() const { return name.empty(); }
 
-    void addImport(imports_type::value_type importName)
+    [[nodiscard]] const TypeDefinition& definition() const { return *_definition; }
+    void setDefinition(TypeDefinition&& definition)
     {
-        lists["imports"].emplace_back(std::move(importName));
+        _definition = TypeDefinition::intern(std::move(definition));
     }
+    [[nodiscard]] const auto& attributes() const { return _definition->attributes; }
+    [[nodiscard]] const auto& lists() const { return _definition->lists; }
+    [[nodiscard]] const std::string& importRenderer() const { return _definition->importRenderer; }
+    void setImportRenderer(std::string renderer);
+    void addImport(imports_type::value_type importName);
 
     std::string_view getAttributeValue(const std::string& attrName) const
     {
-        const auto attrIt = attributes.find(attrName);
-        return attrIt != attributes.end() ? attrIt->second : std::string_view{};
+        const auto attrIt = attributes().find(attrName);
+        return attrIt != attributes().end() ? attrIt->second : std::string_view{};
     }
 
     [[nodiscard]] bool operator==(const TypeUsage& other) const
     {
-        return name == other.name && call == other.call
-               && baseName == other.baseName && attributes == other.attributes
-               && lists == other.lists && paramTypes == other.paramTypes;
+        return name == other.name && call == other.call && baseName == other.baseName
+               && _definition == other._definition && paramTypes == other.paramTypes;
     }
+
+private:
+    const TypeDefinition* _definition = TypeDefinition::defaultDefinition();
+};
+
+template <>
+struct std::hash<TypeUsage> {
+    size_t operator()(const TypeUsage& tu) const;
 };
 
 struct VarDecl : Identifier {
     using string = std::string;
     TypeUsage type;
-    string baseName; ///< Identifier as used in the API
-    string description;
+    Symbol baseName; ///< Identifier as used in the API
+    SharedText description;
     bool required = false;
     string defaultValue;
 
     VarDecl() = default;
-    VarDecl(TypeUsage type, string varName, string baseName, string description,
+    VarDecl(TypeUsage type, string varName, string baseName, SharedText description,
             bool required = false, string defaultValue = {})
-        : Identifier{std::move(varName)}, type(std::move(type))
-        , baseName(std::move(baseName)), description(std::move(description))
+        : Identifier{Symbol(varName)}, type(std::move(type))
+        , baseName(baseName), description(std::move(description))
         , required(required), defaultValue(std::move(defaultValue))
     {}
 
     [[nodiscard]] std::string toString(bool withDefault = false) const;
 };
 
-using VarDecls = std::vector<VarDecl>;
+/// \brief Variables in the order of addition, with lookup by name
+///
+/// Lookups take constant time, so that fields of large schemas can be merged (see
+/// Analyzer::addVarDecl()) without scanning the whole list for each of them. To keep the index
+/// valid, variables can only be added or replaced as a whole, not changed in place.
+class VarDecls {
+public:
+    using value_type = VarDecl;
+    using container_type = std::vector<VarDecl>;
+    using const_iterator = container_type::const_iterator;
+    using size_type = container_type::size_type;
+
+    [[nodiscard]] const_iterator begin() const { return _vars.begin(); }
+    [[nodiscard]] const_iterator end() const { return _vars.end(); }
+    [[nodiscard]] size_type size() const { return _vars.size(); }
+    [[nodiscard]] bool empty() const { return _vars.empty(); }
+    [[nodiscard]] const VarDecl& front() const { return _vars.front(); }
+    [[nodiscard]] const VarDecl& back() const { return _vars.back(); }
+
+    /// Find the first variable named \p name; nullptr if there's none
+    [[nodiscard]] const VarDecl* find(const Symbol& name) const;
+
+    /// Add \p v at the end, even if there's a variable with the same name already
+    void push_back(VarDecl v);
+    /// \brief Add \p v, or replace the variable with the same name
+    /// \return the replaced variable, if any
+    std::optional<VarDecl> addOrReplace(VarDecl v);
+    /// Take all variables out, leaving the list empty
+    [[nodiscard]] container_type release();
+
+private:
+    container_type _vars;
+    std::unordered_map<Symbol, size_type> _index;
+};
+
+/// \brief A read-only sequence of variables from several lists, without copying them
+///
+/// Presents variables from different places (such as parameters of a call, see
+/// Call::collateParams()) as a single list. The view only refers to the variables, so they
+/// must outlive it; neither the view nor its iteration allocate memory.
+class VarDeclsView {
+public:
+    using part_type = std::span<const VarDecl>;
+    /// Enough for all parameter groups and the body of a call
+    static constexpr size_t MaxParts = 5;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = VarDecl;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const VarDecl*;
+        using reference = const VarDecl&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return _view->_parts[_part][_index]; }
+        pointer operator->() const { return &**this; }
+        const_iterator& operator++()
+        {
+            ++_index;
+            settle();
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+        bool operator==(const const_iterator&) const = default;
+
+    private:
+        friend class VarDeclsView;
+
+        const VarDeclsView* _view = nullptr;
+        //! With partitionedByRequired(), required variables are visited on the first pass
+        //! and the rest on the second one
+        size_t _pass = 0;
+        size_t _part = 0;
+        size_t _index = 0;
+
+        const_iterator(const VarDeclsView* view, size_t pass) : _view(view), _pass(pass) {}
+        /// Move to the first variable on or after the current position that belongs to
+        /// the current pass, or to the end
+        void settle();
+    };
+    using iterator = const_iterator;
+
+    VarDeclsView() = default;
+    VarDeclsView(const VarDecls& vars) { add(vars); }
+
+    /// Append \p vars to the view
+    VarDeclsView& add(part_type vars);
+    VarDeclsView& add(const VarDecls& vars) { return add(part_type{vars.begin(), vars.end()}); }
+    VarDeclsView& add(const VarDecl& v) { return add(part_type{&v, 1}); }
+
+    /// The same variables, required ones first, otherwise in the same order
+    [[nodiscard]] VarDeclsView partitionedByRequired() const
+    {
+        auto result = *this;
+        result._partitioned = true;
+        return result;
+    }
+
+    [[nodiscard]] const_iterator begin() const
+    {
+        const_iterator it{this, 0};
+        it.settle();
+        return it;
+    }
+    [[nodiscard]] const_iterator end() const { return {this, _partitioned ? 2u : 1u}; }
+    [[nodiscard]] bool empty() const { return begin() == end(); }
+
+private:
+    std::array<part_type, MaxParts> _parts{};
+    size_t _partCount = 0;
+    bool _partitioned = false;
+};
 
 struct FlatSchema : Identifier {
     explicit FlatSchema(InOut inOut, const Call* scope = nullptr)
-        : Identifier{"", inOut, scope}
+        : Identifier{{}, inOut, scope}
     { }
     // uint16_t because that's as much as JSON accepts for integers
     uint16_t maxProperties = std::numeric_limits<uint16_t>::max();
@@ -138,12 +290,12 @@ struct FlatSchema : Identifier {
 };
 
 struct ObjectSchema : FlatSchema {
-    std::string description;
+    SharedText description;
     std::vector<TypeUsage> parentTypes;
     mutable bool preferInlining = false;
 
     explicit ObjectSchema(InOut inOut, const Call* scope = nullptr,
-                          std::string description = {})
+                          SharedText description = {})
         : FlatSchema(inOut, scope), description(std::move(description))
     { }
     ~ObjectSchema() = default; // Just to satisfy Rule of 5
@@ -253,11 +405,11 @@ struct Path : public std::string
 
 struct Response
 {
-    explicit Response(std::string code, std::string description = {}) :
+    explicit Response(std::string code, SharedText description = {}) :
         code(std::move(code)), description(std::move(description))
     { }
     std::string code;
-    std::string description;
+    SharedText description;
     VarDecls headers;
     std::vector<std::string> contentTypes;
     Body body;
@@ -271,14 +423,25 @@ struct ExternalDocs
 
 enum Location : size_t { InPath = 0, InQuery = 1, InHeaders = 2 };
 
-using types_t = std::vector<std::pair<std::unique_ptr<const ObjectSchema>, TypeUsage>>;
+/// Destroys schemas allocated from a memory resource, see Model::addSchema()
+struct SchemaDeleter {
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource();
+
+    void operator()(const ObjectSchema* schema) const
+    {
+        std::pmr::polymorphic_allocator<>(resource).delete_object(
+            const_cast<ObjectSchema*>(schema));
+    }
+};
+using schema_ptr_t = std::unique_ptr<const ObjectSchema, SchemaDeleter>;
+using types_t = std::vector<std::pair<schema_ptr_t, TypeUsage>>;
 
 struct Call : Identifier {
     using params_type = VarDecls;
     using string = std::string;
 
     Call(Path callPath, string callVerb, string callName, bool deprecated, bool callNeedsSecurity)
-        : Identifier{std::move(callName)}
+        : Identifier{Symbol(callName)}
         , path(std::move(callPath))
         , verb(std::move(callVerb))
         , deprecated(deprecated)
@@ -292,13 +455,14 @@ struct Call : Identifier {
     Call operator=(Call&&) = delete;
 
     [[nodiscard]] params_type& getParamsBlock(const string& blockName);
-    [[nodiscard]] params_type collateParams() const;
+    /// All parameters of the call, including those unpacked from the body
+    [[nodiscard]] VarDeclsView collateParams() const;
 
     Path path;
     std::vector<Server> serverOverride;
     string verb;
     string summary;
-    string description;
+    SharedText description;
     bool deprecated;
     ExternalDocs externalDocs;
     types_t localSchemas;
@@ -314,8 +478,12 @@ struct Call : Identifier {
 
 struct CallClass
 {
-    // Using std::list because it doesn't move the storage around
-    std::list<Call> calls;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit CallClass(const allocator_type& allocator) : calls(allocator) {}
+
+    // Using a list because it doesn't move the storage around
+    std::pmr::list<Call> calls;
 };
 
 enum class ApiSpec { Undefined = 0, Swagger = 20, OpenAPI3 = 31, JSONSchema = 201909 };
@@ -325,6 +493,17 @@ struct Model {
     /// Map from the included path (in API description) to the import renderer
     using imports_type = std::unordered_map<string, string>;
 
+private:
+    /// \brief Storage for schemas and calls of the model
+    ///
+    /// These are allocated in large numbers and all freed at once (see clear() and evict()),
+    /// so a monotonic buffer works best for them; it also keeps them close to each other in
+    /// memory, for faster traversal when printing. Held by pointer to keep the addresses of
+    /// calls stable when the model is moved.
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> _arena =
+        std::make_unique<std::pmr::monotonic_buffer_resource>();
+
+public:
     ApiSpec apiSpec;
 
     imports_type imports;
@@ -332,9 +511,29 @@ struct Model {
     std::unordered_map<std::string, TypeUsage> localRefs;
 
     std::vector<Server> defaultServers;
-    std::list<CallClass> callClasses;
+    std::pmr::list<CallClass> callClasses{_arena.get()};
+
+    /// \brief The roles a JSON Schema model is used in
+    ///
+    /// A JSON Schema model is analysed once, in the role it's first needed for. If it's needed
+    /// for another role later, the model (along with models it depends on) is marked as used
+    /// for InAndOut, instead of analysing it again; roleOf() then overrides roles of its schemas.
+    InOut role = InAndOut;
+    /// Keys of JSON Schema models $ref'ed from this one, each listed once, with the inlining
+    /// preference of the respective $ref's (only preferring inlining if all of them do)
+    std::vector<std::pair<string, bool>> dataDependencies;
+
+    /// \brief Whether the model has been rendered and evicted, see evict()
+    ///
+    /// An evicted model only keeps the type of its main schema (the last in globalSchemas),
+    /// so that other models could still import it; everything else is gone.
+    bool evicted = false;
+    TypeUsage evictedType; //!< The type of the main schema before evict()
+    bool evictedInlined = false; //!< Whether the main schema was to be inlined before evict()
 
     void clear();
+    /// Free the memory taken by the model, except the main type - see Model::evicted
+    void evict();
 
     Call& addCall(Path path, string verb, string operationId, bool deprecated, bool needsToken);
     void addSchema(ObjectSchema&& schema, const TypeUsage &tu);
@@ -351,8 +550,18 @@ struct Model {
         return callClasses.empty() &&
                globalSchemas.size() == 1 && globalSchemas.front().first->trivial();
     }
+    /// The role to generate code for \p schema from this model, see Model::role
+    [[nodiscard]] InOut roleOf(const ObjectSchema& schema) const
+    {
+        return apiSpec == ApiSpec::JSONSchema && role == InAndOut ? InAndOut : schema.role;
+    }
 
 private:
+    /// Schema lists of the calls added by addCall(), to find them without a search
+    std::unordered_map<const Call*, types_t*> _localScopes;
+    /// Names of schemas added to each scope so far; the global scope is under nullptr
+    std::unordered_map<const Call*, std::unordered_set<Symbol>> _schemaNames;
+
     types_t& typesForScope(const Call* s);
 };
 
@@ -367,5 +576,5 @@ inline auto& operator<<(auto& s, const Identifier& id)
         s << id.call->name;
     if (id.call || id.role != InAndOut)
         s << roleToChar(id.role);
-    return s << (id.name.empty() && !id.call ? "(anonymous)" : id.name);
+    return s << (id.name.empty() && !id.call ? "(anonymous)" : id.name.str());
 }
@@ -18,12 +18,16 @@
 
 #include "printer.h"
 
+#include "log.h"
+#include "profiler.h"
+#include "stats.h"
 #include "translator.h"
 
 #include <algorithm>
 #include <locale>
 #include <regex>
 #include <ranges>
+#include <unordered_set>
 
 using namespace std;
 using namespace std::placeholders;
@@ -70,10 +74,11 @@ class GtadContext : public km::context<string>
         using data = km::data;
 
         GtadContext(Printer::fspath inputBasePath, string delimiter,
-                    const data* d)
+                    const data* d, unordered_set<string>& partialFiles)
             : context(d)
             , inputBasePath(std::move(inputBasePath))
             , delimiter(std::move(delimiter))
+            , partialFiles(partialFiles)
         {}
 
         const data* get_partial(const string& name) const override
@@ -82,8 +87,11 @@ class GtadContext : public km::context<string>
                 return result;
 
             auto it = filePartialsCache.find(name);
-            if (it != filePartialsCache.end())
+            if (it != filePartialsCache.end()) {
+                Stats::add("partials", "file cache hits");
                 return &it->second;
+            }
+            Stats::add("partials", "files loaded");
 
             auto srcFileName = inputBasePath / name;
             ifstream ifs { srcFileName };
@@ -100,6 +108,7 @@ class GtadContext : public km::context<string>
 
             string fileContents;
             getline(ifs, fileContents, '\0'); // Won't work on files with NULs
+            partialFiles.insert(srcFileName.string());
             return &filePartialsCache
                         .emplace(name,
                                  makePartial(std::move(fileContents), delimiter))
@@ -109,6 +118,7 @@ class GtadContext : public km::context<string>
     private:
         Printer::fspath inputBasePath;
         string delimiter;
+        unordered_set<string>& partialFiles;
         mutable unordered_map<string, data> filePartialsCache;
 };
 
@@ -163,7 +173,7 @@ Printer::Printer(context_type&& contextObj, fspath inputBasePath,
     {
         _outFilesList.open(_translator.outputBaseDir() / outFilesListPath);
         if (!_outFilesList)
-            clog << "No out files list set or cannot write to the file" << endl;
+            warningLog() << "No out files list set or cannot write to the file";
     }
 }
 
@@ -201,10 +211,10 @@ void setList(object& target, const string& name, const auto& source)
 void dumpDescription(object& target, const auto& model)
 {
     vector<string> lines{};
-    if (!model.description.empty()) {
+    if (const string& description = model.description; !description.empty()) {
         static const regex re{"\\n"};
         lines = {
-            sregex_token_iterator{model.description.cbegin(), model.description.cend(), re, -1},
+            sregex_token_iterator{description.cbegin(), description.cend(), re, -1},
             sregex_token_iterator{}
         };
     }
@@ -213,6 +223,13 @@ void dumpDescription(object& target, const auto& model)
 
 object Printer::renderType(const TypeUsage& tu) const
 {
+    Stats::add("rendering", "renderType() calls");
+    // The same types are used over and over within a model, and rendering parameterised
+    // types recurses into their parameters; so each type is only rendered once per model
+    if (const auto it = _renderedTypes.find(tu); it != _renderedTypes.end())
+        return it->second;
+    Stats::add("rendering", "types rendered");
+
     // This method first produces two contexts: one to render a non-qualified
     // name (in `values`), the other to do a qualified name
     // (in `qualifiedValues`). These contexts are filled in, in particular,
@@ -220,37 +237,48 @@ object Printer::renderType(const TypeUsage& tu) const
     // inner type names in {{1}}, {{2}} etc. Then, using these two contexts,
     // a Mustache object for the current type is made, fully rendering
     // the bare type name in `name` and the qualified name in `qualifiedName`.
-    object values { { "name", partial {[name=tu.name] { return name; }} }
-                  , { "baseName", tu.baseName }
+    object values { { "name", partial {[name=tu.name] { return name.str(); }} }
+                  , { "baseName", tu.baseName.str() }
     };
+
+    // Fill parameters for parameterized types
+    vector<object> mParamTypes;
+    mParamTypes.reserve(tu.paramTypes.size());
+    for (const auto& t: tu.paramTypes)
+        mParamTypes.push_back(renderType(t));
+    setList(values, "types", mParamTypes);
     auto qualifiedValues = values;
+    // Unless there's a scope or a parameter with a different qualified name,
+    // the qualified name is the same as the bare one
+    bool sameQualifiedName = tu.call == nullptr;
     if (tu.call)
     {
         // Not using call->qualifiedName() because:
         // 1) we don't have nested calls as a thing
         // 2) we qualify types, not calls, with call names (think of referring
         //    to another type within the same call)
-        qualifiedValues.emplace("scope", tu.call->name);
+        qualifiedValues.emplace("scope", tu.call->name.str());
     }
-
-    // Fill parameters for parameterized types
-    setList(values, "types", tu.paramTypes, bind_front(&Printer::renderType, this));
-    setList(qualifiedValues, "types", tu.paramTypes, bind_front(&Printer::renderType, this));
     int i = 0;
-    for (const auto& t: tu.paramTypes)
+    for (auto& mParamType: mParamTypes)
     {
         // Substituting {{1}}, {{2}} and so on with actual inner type names
-        auto mParamType = renderType(t);
-        values.emplace(to_string(++i), mParamType["name"]);
-        qualifiedValues.emplace(to_string(i), mParamType["qualifiedName"]);
+        const auto& paramName = mParamType["name"];
+        const auto& paramQualifiedName = mParamType["qualifiedName"];
+        sameQualifiedName &= paramName.string_value() == paramQualifiedName.string_value();
+        values.emplace(to_string(++i), paramName);
+        qualifiedValues.emplace(to_string(i), paramQualifiedName);
     }
 
-    GtadContext context {_inputBasePath, _delimiter, &_contextData};
-    return {{"name", renderWithOverlay(_typeRenderer, context, values)}
-           ,{"qualifiedName",
-             renderWithOverlay(_typeRenderer, context, qualifiedValues)}
-           ,{"baseName", tu.baseName}
-           };
+    GtadContext context {_inputBasePath, _delimiter, &_contextData, _partialFiles};
+    auto name = renderWithOverlay(_typeRenderer, context, values);
+    auto qualifiedName =
+        sameQualifiedName ? name : renderWithOverlay(_typeRenderer, context, qualifiedValues);
+    return _renderedTypes
+        .try_emplace(tu, object{{"name", std::move(name)},
+                                {"qualifiedName", std::move(qualifiedName)},
+                                {"baseName", tu.baseName.str()}})
+        .first->second;
 }
 
 object Printer::dumpField(const VarDecl& field) const
@@ -260,7 +288,7 @@ object Printer::dumpField(const VarDecl& field) const
         tolower(paramNameCamelCase.front(), locale::classic());
 
     object fieldDef { { "dataType",      renderType(field.type) }
-                    , { "baseName",      field.baseName }
+                    , { "baseName",      field.baseName.str() }
                     , { "paramName",     paramNameCamelCase } // Swagger compat
                     , { "nameCamelCase", paramNameCamelCase }
                       // TODO: nameSnakeCase
@@ -271,10 +299,10 @@ object Printer::dumpField(const VarDecl& field) const
     if (!field.defaultValue.empty())
         fieldDef.emplace("defaultValue", field.defaultValue);
 
-    for (const auto& attr: field.type.attributes)
+    for (const auto& attr: field.type.attributes())
         fieldDef.emplace(attr.first, partial {[v=attr.second] { return v; }});
 
-    for (const auto& listAttr: field.type.lists)
+    for (const auto& listAttr: field.type.lists())
     {
         km::list mAttrValue;
         for (const auto& i: listAttr.second)
@@ -285,17 +313,11 @@ object Printer::dumpField(const VarDecl& field) const
 }
 
 void Printer::addList(object& target, const string& name,
-                      const VarDecls& properties) const
+                      const VarDeclsView& properties) const
 {
     setList(target, name, properties, bind_front(&Printer::dumpField, this));
 }
 
-inline auto copyPartitionedByRequired(std::vector<VarDecl> vars)
-{
-    ranges::stable_partition(vars, &VarDecl::required);
-    return vars;
-}
-
 bool Printer::dumpAdditionalProperties(m_object_type& target, const FlatSchema& s) const
 {
     if (!s.hasAdditionalProperties())
@@ -307,7 +329,7 @@ bool Printer::dumpAdditionalProperties(m_object_type& target, const FlatSchema&
     return true;
 }
 
-std::optional<object> Printer::dumpTypes(const types_t& types) const
+std::optional<object> Printer::dumpTypes(const types_t& types, const Model* model) const
 {
     // Unnamed schemas are only saved in the model to enable inlining
     // but cannot be used to emit valid code (not in C++ at least), so skip them from the context.
@@ -319,12 +341,13 @@ std::optional<object> Printer::dumpTypes(const types_t& types) const
 
     object mModels;
     setList(
-        mModels, "model", completeDefs, [this](const types_t::value_type& type) {
+        mModels, "model", completeDefs, [this, model](const types_t::value_type& type) {
             auto mType = renderType(type.second);
-            mType["classname"] = type.first->name; // Swagger compat
+            mType["classname"] = type.first->name.str(); // Swagger compat
             dumpDescription(mType, *type.first);
-            mType["in?"] = type.first->role != OnlyOut;
-            mType["out?"] = type.first->role != OnlyIn;
+            const auto role = model ? model->roleOf(*type.first) : type.first->role;
+            mType["in?"] = role != OnlyOut;
+            mType["out?"] = role != OnlyIn;
             if (type.first->trivial())
             {
                 mType["trivial?"] = true;
@@ -332,11 +355,11 @@ std::optional<object> Printer::dumpTypes(const types_t& types) const
             }
             setList(mType, "parents", type.first->parentTypes,
                     bind_front(&Printer::renderType, this));
-            setList(mType, "vars", copyPartitionedByRequired(type.first->fields),
+            setList(mType, "vars", VarDeclsView(type.first->fields).partitionedByRequired(),
                 [this](const VarDecl& f) {
                     object fieldDef = dumpField(f);
-                    fieldDef["name"] = f.name;
-                    fieldDef["datatype"] = f.type.name; // Swagger compat
+                    fieldDef["name"] = f.name.str();
+                    fieldDef["datatype"] = f.type.name.str(); // Swagger compat
                     return fieldDef;
                 });
             dumpAdditionalProperties(mType, *type.first);
@@ -359,11 +382,15 @@ vector<string> Printer::print(const fspath& filePathBase,
                               const Model& model) const
 {
     if (model.empty()) {
-        clog << "Empty model, no files will be emitted" << endl;
+        warningLog() << "Empty model, no files will be emitted";
         return {};
     }
 
-    GtadContext context{_inputBasePath, _delimiter, &_contextData};
+    const Profiler::TraceSpan _traceSpan(Profiler::Rendering, filePathBase.string());
+    // Scopes of types are only meaningful within a model, and calls of evicted models may
+    // share addresses with calls of this one
+    _renderedTypes.clear();
+    GtadContext context{_inputBasePath, _delimiter, &_contextData, _partialFiles};
 
     object payloadObj{
         {"filenameBase"s, filePathBase.filename().string()}
@@ -377,9 +404,8 @@ vector<string> Printer::print(const fspath& filePathBase,
     setList(payloadObj, "imports", model.imports,
             [this, &context](const pair<string, string>& import) -> string {
                 if (import.first.empty() || import.second.empty()) {
-                    cerr << "Warning: empty import, the emitted code will "
-                            "likely be invalid"
-                         << endl;
+                    warningLog() << "Warning: empty import, the emitted code will "
+                                    "likely be invalid";
                     return {};
                 }
                 static unordered_map<string, template_type> tmplCache {};
@@ -397,7 +423,7 @@ vector<string> Printer::print(const fspath& filePathBase,
                                          importContextObj);
             });
 
-    auto&& mMaybeTypes = dumpTypes(model.globalSchemas);
+    auto&& mMaybeTypes = dumpTypes(model.globalSchemas, &model);
     payloadObj.emplace("models", mMaybeTypes.value_or(object{}));
 
     object mOperations;
@@ -407,7 +433,7 @@ vector<string> Printer::print(const fspath& filePathBase,
         // Any attributes should be added after setList
         setList(mOperations, "operation", callClass.calls, [&](const Call& call) {
             object mCall{
-                {"operationId", call.name          },
+                {"operationId", call.name.str()    },
                 {"httpMethod",  call.verb          },
                 {"path",        call.path          },
                 {"summary",     call.summary       },
@@ -435,7 +461,7 @@ vector<string> Printer::print(const fspath& filePathBase,
                 };
             });
 
-            addList(mCall, "allParams", copyPartitionedByRequired(call.collateParams()));
+            addList(mCall, "allParams", call.collateParams().partitionedByRequired());
             for (size_t i = 0; i < Call::ParamGroups.size(); ++i)
                 addList(mCall, Call::ParamGroups[i] + "Params",
                         call.params[i]);
@@ -456,14 +482,12 @@ vector<string> Printer::print(const fspath& filePathBase,
                 object mResponse{{"code", r.code},
                                  {"normalResponse?", r.code == "200"}};
 
-                VarDecls allProperties;
-                copy(r.headers.begin(), r.headers.end(),
-                     back_inserter(allProperties));
+                VarDeclsView allProperties{r.headers};
 
                 dispatchVisit(r.body,
                     [this, &mResponse, &allProperties](const FlatSchema& unpackedBody) {
                         addList(mResponse, "properties", unpackedBody.fields);
-                        ranges::copy(unpackedBody.fields, back_inserter(allProperties));
+                        allProperties.add(unpackedBody.fields);
                         if (!dumpAdditionalProperties(mResponse, unpackedBody)
                             && unpackedBody.fields.size() == 1)
                             mResponse["singleValue?"] = true;
@@ -471,12 +495,11 @@ vector<string> Printer::print(const fspath& filePathBase,
                     [this, &mResponse, &allProperties](const VarDecl& packedBody) {
                         mResponse.emplace("inlineResponse",
                                           dumpField(packedBody));
-                        allProperties.emplace_back(packedBody);
+                        allProperties.add(packedBody);
                     },
                     [](monostate) {});
-                for (const auto& src: {{"allProperties", allProperties},
-                                       pair{"headers", r.headers}})
-                    addList(mResponse, src.first, src.second);
+                addList(mResponse, "allProperties", allProperties);
+                addList(mResponse, "headers", r.headers);
 
                 return mResponse;
             });
@@ -492,8 +515,8 @@ vector<string> Printer::print(const fspath& filePathBase,
         }
     }
     if (!mMaybeTypes && mOperations.empty()) {
-        clog << "No emittable contents found in the model for " << filePathBase.string()
-             << ".*, skipping\n";
+        warningLog() << "No emittable contents found in the model for " << filePathBase.string()
+                     << ".*, skipping";
         return {};
     }
 
@@ -503,18 +526,25 @@ vector<string> Printer::print(const fspath& filePathBase,
     emittedFilenames.reserve(outputs.size());
     for (const auto& [fPath, fTemplate]: outputs) {
         const auto& fPathString = fPath.string();
+        const Profiler::Scope _profilerScope(Profiler::Rendering, fPathString, fTemplate);
         ofstream ofs{fPath};
         if (!ofs.good())
             throw Exception(fPathString + ": Couldn't open for writing");
 
-        cout << "Emitting " << fPathString << endl;
+        infoLog() << "Emitting " << fPathString;
         auto fullTemplate = makeMustache(fTemplate);
         fullTemplate.render(context, ofs);
+        Stats::add("output", "bytes written", uint64_t(ofs.tellp()));
         if (fullTemplate.error_message().empty()) {
-            _outFilesList << fPathString << endl;
+            _outFilesList << fPathString << '\n';
             emittedFilenames.push_back(fPathString);
         } else
-            clog << fPath << ": " << fullTemplate.error_message() << endl;
+            errorLog() << fPath << ": " << fullTemplate.error_message();
     }
     return emittedFilenames;
 }
+
+void Printer::listOutFile(const string& fileName) const
+{
+    _outFilesList << fileName << '\n';
+}
@@ -6,6 +6,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <unordered_set>
 
 class Translator;
 
@@ -29,6 +30,10 @@ public:
     Printer::template_type makeMustache(const string& tmpl) const;
     std::vector<std::string> print(const fspath& filePathBase,
                                    const Model& model) const;
+    //! Add a file emitted by a previous run to the out files list
+    void listOutFile(const string& fileName) const;
+    //! Files loaded as partials by print() so far
+    const std::unordered_set<string>& partialFiles() const { return _partialFiles; }
 
 private:
     const Translator& _translator;
@@ -37,11 +42,15 @@ private:
     template_type _typeRenderer;
     fspath _inputBasePath;
     mutable std::ofstream _outFilesList;
+    mutable std::unordered_set<string> _partialFiles;
+    //! Types rendered for the model being printed, see renderType()
+    mutable std::unordered_map<TypeUsage, m_object_type> _renderedTypes;
 
     [[nodiscard]] m_object_type renderType(const TypeUsage& tu) const;
     [[nodiscard]] m_object_type dumpField(const VarDecl& field) const;
     void addList(m_object_type& target, const string& name,
-                 const VarDecls& properties) const;
+                 const VarDeclsView& properties) const;
     bool dumpAdditionalProperties(m_object_type& target, const FlatSchema& s) const;
-    [[nodiscard]] std::optional<m_object_type> dumpTypes(const types_t& types) const;
+    [[nodiscard]] std::optional<m_object_type> dumpTypes(const types_t& types,
+                                                         const Model* model = nullptr) const;
 };
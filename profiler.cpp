@@ -0,0 +1,346 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "profiler.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <ranges>
+#include <system_error>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace chrono;
+
+namespace {
+constexpr array<string_view, Profiler::PhaseCount> phaseNames{
+    "configuration", "scheduling", "parsing", "analysis", "rendering", "clang-format"};
+
+constexpr array<string_view, Profiler::CounterCount> counterNames{
+    "cycles", "instructions", "cache misses", "branch misses"};
+
+constexpr size_t ReportedSubjects = 10;
+
+struct Totals {
+    Profiler::clock::duration time{};
+    size_t count = 0;
+    Profiler::counters_t counters{};
+};
+
+struct TraceEvent {
+    string name;
+    Profiler::Phase phase;
+    string group;
+    Profiler::clock::time_point start;
+    Profiler::clock::time_point end;
+    unsigned threadId;
+};
+
+struct Records {
+    mutex mtx;
+    Profiler::clock::time_point start = Profiler::clock::now();
+    array<Totals, Profiler::PhaseCount> phases{};
+    array<string_map_t<Totals>, Profiler::PhaseCount> subjects{};
+    array<string_map_t<Totals>, Profiler::PhaseCount> groups{};
+    //! Why a given counter could not be read; empty for working counters
+    array<string, Profiler::CounterCount> counterErrors{};
+    vector<TraceEvent> traceEvents{};
+};
+
+Records& records()
+{
+    static Records r;
+    return r;
+}
+
+void setCounterError(Profiler::Counter counter, string message)
+{
+    auto& r = records();
+    const lock_guard lock(r.mtx);
+    if (r.counterErrors[counter].empty())
+        r.counterErrors[counter] = std::move(message);
+}
+
+thread_local Profiler::Scope* currentScope = nullptr;
+
+//! Small sequential thread numbers are easier on the eye in trace viewers than native ids
+unsigned traceThreadId()
+{
+    static atomic_uint nextId = 1;
+    thread_local const auto id = nextId++;
+    return id;
+}
+
+void addTraceEvent(string_view name, Profiler::Phase phase, string_view group,
+                   Profiler::clock::time_point start)
+{
+    const auto end = Profiler::clock::now();
+    const auto threadId = traceThreadId();
+    auto& r = records();
+    const lock_guard lock(r.mtx);
+    r.traceEvents.push_back({string(name), phase, string(group), start, end, threadId});
+}
+
+//! Hardware performance counters of the current thread
+class ThreadCounters {
+public:
+#ifdef __linux__
+    ThreadCounters()
+    {
+        static constexpr array<uint64_t, Profiler::CounterCount> configs{
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES};
+        for (size_t i = 0; i < Profiler::CounterCount; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            // User space only, to work with the default perf_event_paranoid setting
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // Let the counters of the main thread include clang-format; threads spawned by it
+            // only add their counts after exiting, outside of any scope in the main thread
+            attr.inherit = 1;
+            _fds[i] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (_fds[i] < 0)
+                setCounterError(Profiler::Counter(i),
+                                error_code(errno, system_category()).message());
+        }
+    }
+    ~ThreadCounters()
+    {
+        for (const auto fd : _fds)
+            if (fd >= 0)
+                close(fd);
+    }
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    [[nodiscard]] Profiler::counters_t read() const
+    {
+        Profiler::counters_t result{};
+        for (size_t i = 0; i < Profiler::CounterCount; ++i)
+            if (_fds[i] >= 0 && ::read(_fds[i], &result[i], sizeof(uint64_t)) != sizeof(uint64_t))
+                result[i] = 0;
+        return result;
+    }
+
+private:
+    array<int, Profiler::CounterCount> _fds{};
+#else
+    ThreadCounters()
+    {
+        for (size_t i = 0; i < Profiler::CounterCount; ++i)
+            setCounterError(Profiler::Counter(i), "only supported on Linux");
+    }
+
+    [[nodiscard]] Profiler::counters_t read() const { return {}; }
+#endif
+};
+
+Profiler::counters_t readCounters()
+{
+    thread_local const ThreadCounters counters;
+    return counters.read();
+}
+
+string formatDuration(Profiler::clock::duration d)
+{
+    return format("{:10.1f} ms", duration<double, milli>(d).count());
+}
+
+void reportSlowest(ostream& os, string_view title, const string_map_t<Totals>& totals)
+{
+    if (totals.empty())
+        return;
+
+    vector<pair<string_view, Totals>> sorted(totals.begin(), totals.end());
+    const auto reportedCount = min(sorted.size(), ReportedSubjects);
+    ranges::partial_sort(sorted, sorted.begin() + ptrdiff_t(reportedCount), ranges::greater{},
+                         [](const auto& p) { return p.second.time; });
+    os << "Slowest " << title << ":\n";
+    for (const auto& [name, t] : sorted | views::take(reportedCount))
+        os << formatDuration(t.time) << " (" << t.count << "x) " << name << '\n';
+}
+} // namespace
+
+Profiler::Scope::Scope(Phase phase, string_view subject, string_view group)
+    : _phase(phase), _active(Profiler::enabled() || Profiler::tracing())
+{
+    if (!_active)
+        return;
+    _subject = subject;
+    _group = group;
+    _parent = currentScope;
+    currentScope = this;
+    _start = clock::now();
+    if (_countersEnabled)
+        _startCounters = readCounters();
+}
+
+Profiler::Scope::~Scope()
+{
+    if (!_active)
+        return;
+    counters_t ownCounters{};
+    if (_countersEnabled) {
+        const auto endCounters = readCounters();
+        for (size_t i = 0; i < CounterCount; ++i) {
+            const auto delta = endCounters[i] - _startCounters[i];
+            if (_parent)
+                _parent->_nestedCounters[i] += delta;
+            ownCounters[i] = delta > _nestedCounters[i] ? delta - _nestedCounters[i] : 0;
+        }
+    }
+    if (_tracing)
+        addTraceEvent(_subject.empty() ? phaseNames[_phase] : _subject, _phase, _group, _start);
+    const auto elapsed = clock::now() - _start;
+    currentScope = _parent;
+    if (_parent)
+        _parent->_nestedTime += elapsed;
+
+    const auto ownTime = elapsed - _nestedTime;
+    auto& r = records();
+    const lock_guard lock(r.mtx);
+    const auto add = [ownTime, &ownCounters](Totals& t) {
+        t.time += ownTime;
+        ++t.count;
+        for (size_t i = 0; i < CounterCount; ++i)
+            t.counters[i] += ownCounters[i];
+    };
+    add(r.phases[_phase]);
+    if (!_subject.empty())
+        add(r.subjects[_phase][_subject]);
+    if (!_group.empty())
+        add(r.groups[_phase][_group]);
+}
+
+Profiler::TraceSpan::TraceSpan(Phase phase, string_view name) : _phase(phase)
+{
+    if (!Profiler::tracing() || name.empty())
+        return;
+    _name = name;
+    _start = clock::now();
+}
+
+Profiler::TraceSpan::~TraceSpan()
+{
+    if (!_name.empty())
+        addTraceEvent(_name, _phase, {}, _start);
+}
+
+void Profiler::enable()
+{
+    _enabled = true;
+    records().start = clock::now();
+}
+
+void Profiler::enableTrace()
+{
+    _tracing = true;
+    records().start = clock::now();
+}
+
+void Profiler::enableCounters()
+{
+    enable();
+    _countersEnabled = true;
+}
+
+void Profiler::report(ostream& os)
+{
+    auto& r = records();
+    const lock_guard lock(r.mtx);
+    const auto totalTime = clock::now() - r.start;
+    os << "Time by phase, excluding nested phases:\n";
+    auto accountedTime = clock::duration::zero();
+    for (size_t i = 0; i < PhaseCount; ++i) {
+        os << formatDuration(r.phases[i].time) << ' ' << phaseNames[i] << '\n';
+        accountedTime += r.phases[i].time;
+    }
+    // With --jobs, phases on different threads overlap, and the sum may exceed the total
+    if (accountedTime < totalTime)
+        os << formatDuration(totalTime - accountedTime) << " other\n";
+    os << formatDuration(totalTime) << " total (wall clock)\n";
+
+    if (_countersEnabled) {
+        os << "Hardware counters by phase, excluding nested phases:\n" << format("{:14}", "");
+        for (const auto& name : counterNames)
+            os << format("{:>15}", name);
+        os << format("{:>6}", "IPC") << '\n';
+        for (size_t i = 0; i < PhaseCount; ++i) {
+            const auto& counters = r.phases[i].counters;
+            os << format("{:14}", phaseNames[i]);
+            for (size_t j = 0; j < CounterCount; ++j)
+                os << (r.counterErrors[j].empty() ? format("{:>15}", counters[j])
+                                                  : format("{:>15}", "n/a"));
+            if (counters[Cycles] > 0 && r.counterErrors[Instructions].empty())
+                os << format("{:>6.2f}", double(counters[Instructions]) / double(counters[Cycles]));
+            os << '\n';
+        }
+        for (size_t j = 0; j < CounterCount; ++j)
+            if (!r.counterErrors[j].empty())
+                os << "Counter \"" << counterNames[j]
+                   << "\" is not available: " << r.counterErrors[j] << '\n';
+    }
+
+    reportSlowest(os, "files (parsing)", r.subjects[Parsing]);
+    reportSlowest(os, "models (analysis)", r.subjects[Analysis]);
+    reportSlowest(os, "templates", r.groups[Rendering]);
+    reportSlowest(os, "output files", r.subjects[Rendering]);
+}
+
+bool Profiler::writeTrace(const filesystem::path& filePath)
+{
+    ofstream ofs{filePath};
+    if (!ofs.good())
+        return false;
+
+    auto& r = records();
+    const lock_guard lock(r.mtx);
+    const auto microseconds = [](clock::duration d) { return duration<double, micro>(d).count(); };
+    // Complete ("X") events, as understood by chrome://tracing and Perfetto
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (bool first = true; const auto& e : r.traceEvents) {
+        if (!first)
+            ofs << ',';
+        first = false;
+        ofs << "\n{\"name\":\"" << escapeJson(e.name) << "\",\"cat\":\"" << phaseNames[e.phase]
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.threadId
+            << format(",\"ts\":{:.3f},\"dur\":{:.3f}", microseconds(e.start - r.start),
+                      microseconds(e.end - e.start));
+        if (!e.group.empty())
+            ofs << ",\"args\":{\"group\":\"" << escapeJson(e.group) << "\"}";
+        ofs << '}';
+    }
+    ofs << "\n]}\n";
+    return ofs.good();
+}
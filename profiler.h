@@ -0,0 +1,116 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/// \brief Wall-clock timing of generation phases, enabled by --profile
+///
+/// Code to be timed is wrapped in Profiler::Scope objects. Each scope accounts for its own
+/// time, excluding any scopes nested in it on the same thread - so that, e.g., parsing
+/// a $ref'ed file during analysis is counted as parsing and not as analysis. The time is
+/// summed up per phase, per subject (an input or output file) and per group of subjects
+/// (e.g., a template that several output files are rendered with). Optionally, hardware
+/// performance counters are collected per phase in the same way.
+///
+/// With --trace-out, each scope is also recorded as a span in Chrome trace event format,
+/// along with TraceSpan objects that mark interesting points within phases.
+class Profiler {
+public:
+    enum Phase : uint8_t {
+        Configuration,
+        Scheduling,
+        Parsing,
+        Analysis,
+        Rendering,
+        Formatting,
+        PhaseCount
+    };
+
+    enum Counter : uint8_t { Cycles, Instructions, CacheMisses, BranchMisses, CounterCount };
+
+    using clock = std::chrono::steady_clock;
+    using counters_t = std::array<uint64_t, CounterCount>;
+
+    class Scope {
+    public:
+        /// Start timing \p phase; does nothing unless profiling or tracing is enabled
+        explicit Scope(Phase phase, std::string_view subject = {}, std::string_view group = {});
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Phase _phase;
+        bool _active;
+        std::string _subject;
+        std::string _group;
+        clock::time_point _start;
+        clock::duration _nestedTime{};
+        counters_t _startCounters{};
+        counters_t _nestedCounters{};
+        Scope* _parent = nullptr;
+    };
+
+    /// A span only recorded in the trace, without affecting the profiling report
+    class TraceSpan {
+    public:
+        /// Start a span; does nothing unless tracing is enabled or \p name is empty
+        explicit TraceSpan(Phase phase, std::string_view name);
+        ~TraceSpan();
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        Phase _phase;
+        std::string _name;
+        clock::time_point _start;
+    };
+
+    /// Turn profiling on; not thread-safe, call it before spawning any threads
+    static void enable();
+    [[nodiscard]] static bool enabled() { return _enabled; }
+    /// \brief Turn profiling on along with hardware performance counters
+    ///
+    /// Counters are only supported on Linux, and may be unavailable even there (e.g., in
+    /// containers or with a restrictive perf_event_paranoid setting); the report says so
+    /// instead of showing the numbers in that case.
+    static void enableCounters();
+
+    /// Start recording spans; not thread-safe, call it before spawning any threads
+    static void enableTrace();
+    [[nodiscard]] static bool tracing() { return _tracing; }
+
+    /// Print the time spent in each phase and the slowest subjects
+    static void report(std::ostream& os);
+    /// Save the recorded spans in Chrome trace event format; returns false on failure
+    static bool writeTrace(const std::filesystem::path& filePath);
+
+private:
+    static inline bool _enabled = false;
+    static inline bool _tracing = false;
+    static inline bool _countersEnabled = false;
+};
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "snapshot.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QSaveFile>
+
+#include <cstring>
+
+using namespace std;
+
+string hashContents(string_view data)
+{
+    return QCryptographicHash::hash(QByteArrayView(data.data(), qsizetype(data.size())),
+                                    QCryptographicHash::Sha256)
+        .toHex()
+        .toStdString();
+}
+
+void SnapshotWriter::addNumber(uint64_t n)
+{
+    _data.append(reinterpret_cast<const char*>(&n), sizeof n);
+}
+
+void SnapshotWriter::addString(string_view s)
+{
+    addNumber(s.size());
+    _data.append(s);
+}
+
+void SnapshotWriter::addOptionalString(const optional<string>& s)
+{
+    addNumber(s.has_value());
+    if (s)
+        addString(*s);
+}
+
+bool SnapshotWriter::saveTo(const filesystem::path& filePath) const
+{
+    if (error_code ec; filePath.has_parent_path())
+        filesystem::create_directories(filePath.parent_path(), ec);
+    QSaveFile f(QString::fromStdString(filePath.string()));
+    return f.open(QIODevice::WriteOnly)
+           && f.write(_data.data(), qint64(_data.size())) == qint64(_data.size()) && f.commit();
+}
+
+string_view SnapshotReader::take(size_t size)
+{
+    if (size > _data.size())
+        throw Exception("Unexpected end of snapshot data");
+    const auto result = _data.substr(0, size);
+    _data.remove_prefix(size);
+    return result;
+}
+
+uint64_t SnapshotReader::takeNumber()
+{
+    uint64_t n = 0;
+    memcpy(&n, take(sizeof n).data(), sizeof n); // The data are not necessarily aligned
+    return n;
+}
+
+string SnapshotReader::takeString()
+{
+    return string(take(takeNumber()));
+}
+
+optional<string> SnapshotReader::takeOptionalString()
+{
+    if (takeNumber() != 0)
+        return takeString();
+    return nullopt;
+}
+
+MappedFile::MappedFile(const filesystem::path& filePath)
+    : _file(QString::fromStdString(filePath.string()))
+{
+    if (_file.open(QIODevice::ReadOnly) && _file.size() > 0)
+        if (const auto* data = _file.map(0, _file.size()))
+            _contents = {reinterpret_cast<const char*>(data), size_t(_file.size())};
+}
+
+const string& generatorKey()
+{
+    static const auto key = [] {
+        // Any rebuild replaces the executable; checking that is much cheaper than hashing it
+        const filesystem::path executablePath =
+            QCoreApplication::applicationFilePath().toStdString();
+        error_code ec;
+        const auto size = filesystem::file_size(executablePath, ec);
+        if (ec)
+            return string();
+        const auto modificationTime = filesystem::last_write_time(executablePath, ec);
+        if (ec)
+            return string();
+        return QCoreApplication::applicationVersion().toStdString() + '/' + to_string(size)
+               + '/' + to_string(modificationTime.time_since_epoch().count());
+    }();
+    return key;
+}
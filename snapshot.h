@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+#include "util.h"
+
+#include <QtCore/QFile>
+
+#include <cstdint>
+#include <filesystem>
+
+/// A hex-encoded SHA-256 hash of \p data, to detect changes in files between runs
+[[nodiscard]] std::string hashContents(std::string_view data);
+
+/// \brief Identifies the build of GTAD that is running
+///
+/// Data saved between runs (the configuration snapshot, the regeneration manifest) depend on
+/// how GTAD interprets its inputs, which may change with any rebuild, not just a new version.
+/// The key consists of the application version, the size and the modification time of
+/// the executable.
+/// \return the key; empty if the executable cannot be found, in which case nothing should be
+///         reused from previous runs
+[[nodiscard]] const std::string& generatorKey();
+
+/// \brief Binary serialisation of plain data to keep it between runs
+///
+/// Numbers are stored in the native byte order, so snapshots are not meant to be portable
+/// between machines; strings are stored with their length prepended.
+class SnapshotWriter {
+public:
+    void addNumber(uint64_t n);
+    void addString(std::string_view s);
+    void addOptionalString(const std::optional<std::string>& s);
+
+    /// Atomically (re)write the file at \p filePath; returns false on failure
+    bool saveTo(const std::filesystem::path& filePath) const;
+
+private:
+    std::string _data;
+};
+
+/// \brief Reading of data stored by SnapshotWriter
+///
+/// All take*() methods throw Exception if the data end prematurely
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::string_view data) : _data(data) {}
+
+    [[nodiscard]] uint64_t takeNumber();
+    [[nodiscard]] std::string takeString();
+    [[nodiscard]] std::optional<std::string> takeOptionalString();
+    [[nodiscard]] bool atEnd() const { return _data.empty(); }
+
+private:
+    std::string_view _data;
+
+    std::string_view take(size_t size);
+};
+
+/// A read-only memory mapping of the whole file, for use with SnapshotReader
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& filePath);
+
+    /// Empty if the file could not be mapped
+    [[nodiscard]] std::string_view contents() const { return _contents; }
+
+private:
+    QFile _file;
+    std::string_view _contents;
+};
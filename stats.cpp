@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "stats.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+struct Counters {
+    mutex mtx;
+    string_map_t<string_map_t<uint64_t>> groups;
+
+    //! A copy of the counters sorted by group and name
+    map<string, map<string, uint64_t>> sorted()
+    {
+        const lock_guard lock(mtx);
+        map<string, map<string, uint64_t>> result;
+        for (const auto& [group, names] : groups)
+            result[group].insert(names.begin(), names.end());
+        return result;
+    }
+};
+
+Counters& counters()
+{
+    static Counters c;
+    return c;
+}
+} // namespace
+
+void Stats::doAdd(string_view group, string_view name, uint64_t n)
+{
+    auto& c = counters();
+    const lock_guard lock(c.mtx);
+    auto groupIt = c.groups.find(group);
+    if (groupIt == c.groups.end())
+        groupIt = c.groups.emplace(group, string_map_t<uint64_t>{}).first;
+    auto nameIt = groupIt->second.find(name);
+    if (nameIt == groupIt->second.end())
+        nameIt = groupIt->second.emplace(name, 0).first;
+    nameIt->second += n;
+}
+
+void Stats::report(ostream& os)
+{
+    for (const auto& [group, names] : counters().sorted()) {
+        os << group << ":\n";
+        for (const auto& [name, value] : names)
+            os << "  " << name << ": " << value << '\n';
+    }
+}
+
+bool Stats::writeJson(const filesystem::path& filePath)
+{
+    ofstream ofs{filePath};
+    if (!ofs.good())
+        return false;
+
+    ofs << '{';
+    for (bool firstGroup = true; const auto& [group, names] : counters().sorted()) {
+        ofs << (firstGroup ? "\n" : ",\n") << "  \"" << escapeJson(group) << "\": {";
+        firstGroup = false;
+        for (bool first = true; const auto& [name, value] : names) {
+            ofs << (first ? "\n" : ",\n") << "    \"" << escapeJson(name) << "\": " << value;
+            first = false;
+        }
+        ofs << "\n  }";
+    }
+    ofs << "\n}\n";
+    return ofs.good();
+}
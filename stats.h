@@ -0,0 +1,53 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+
+/// \brief Counters of events on hot paths, enabled by --stats
+///
+/// Counters are organised in groups (e.g., regex evaluations) and identified by names within
+/// a group (e.g., the configuration section with the regexes). Counting is thread-safe; when
+/// statistics are not enabled, add() only checks a flag.
+class Stats {
+public:
+    /// Turn counting on; not thread-safe, call it before spawning any threads
+    static void enable() { _enabled = true; }
+    [[nodiscard]] static bool enabled() { return _enabled; }
+
+    static void add(std::string_view group, std::string_view name, uint64_t n = 1)
+    {
+        if (_enabled)
+            doAdd(group, name, n);
+    }
+
+    /// Print all counters, sorted by group and name
+    static void report(std::ostream& os);
+    /// Save all counters as a JSON object of groups; returns false on failure
+    static bool writeJson(const std::filesystem::path& filePath);
+
+private:
+    static inline bool _enabled = false;
+
+    static void doAdd(std::string_view group, std::string_view name, uint64_t n);
+};
@@ -0,0 +1,78 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#include "symbol.h"
+
+#include "util.h"
+
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+struct Shard {
+    shared_mutex mtx;
+    // Node-based, so elements don't move around; heterogeneous lookup saves a temporary string
+    unordered_set<string, string_hash, equal_to<>> strings;
+};
+
+//! The table is split by the text hash, so that threads adding different symbols rarely meet
+constexpr size_t ShardCount = 32;
+
+array<Shard, ShardCount>& shards()
+{
+    static array<Shard, ShardCount> s;
+    return s;
+}
+
+const string* intern(string_view text)
+{
+    // Most symbols get used many times over by the same thread; these are found without
+    // any locking. The keys point to the interned strings, so they never dangle.
+    thread_local unordered_map<string_view, const string*> knownToThisThread;
+    if (const auto it = knownToThisThread.find(text); it != knownToThisThread.end())
+        return it->second;
+
+    auto& shard = shards()[string_hash{}(text) % ShardCount];
+    const string* result = nullptr;
+    {
+        const shared_lock lock(shard.mtx);
+        if (const auto it = shard.strings.find(text); it != shard.strings.end())
+            result = &*it;
+    }
+    if (!result) {
+        const lock_guard lock(shard.mtx);
+        result = &*shard.strings.emplace(text).first;
+    }
+    knownToThisThread.emplace(*result, result);
+    return result;
+}
+} // namespace
+
+Symbol::Symbol()
+{
+    static const auto* const emptyText = intern({});
+    _text = emptyText;
+}
+
+Symbol::Symbol(string_view text) : _text(intern(text)) {}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Copyright (C) 2026 GTAD contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+
+#pragma once
+
+#include <compare>
+#include <format>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+/// \brief An interned string
+///
+/// All symbols with the same text share a single copy of it that lives until the end of
+/// the program; so a symbol is just a pointer, cheap to copy and to compare for equality.
+/// Used for names that are repeated across the model many times over (identifiers and type
+/// names). Creating a symbol from text takes a lookup in the global table and is thread-safe;
+/// as this is not free, symbols are only created from text explicitly.
+class Symbol {
+public:
+    Symbol();
+    explicit Symbol(std::string_view text);
+    explicit Symbol(const std::string& text) : Symbol(std::string_view(text)) {}
+    explicit Symbol(const char* text) : Symbol(std::string_view(text)) {}
+
+    [[nodiscard]] const std::string& str() const { return *_text; }
+    operator const std::string&() const { return *_text; }
+    operator std::string_view() const { return *_text; }
+
+    [[nodiscard]] bool empty() const { return _text->empty(); }
+    [[nodiscard]] size_t size() const { return _text->size(); }
+    [[nodiscard]] const char* c_str() const { return _text->c_str(); }
+
+    [[nodiscard]] bool operator==(const Symbol& other) const { return _text == other._text; }
+    [[nodiscard]] bool operator==(std::string_view other) const { return *_text == other; }
+    [[nodiscard]] bool operator==(const std::string& other) const { return *_text == other; }
+    [[nodiscard]] bool operator==(const char* other) const { return *_text == other; }
+    [[nodiscard]] auto operator<=>(const Symbol& other) const { return *_text <=> *other._text; }
+
+    friend std::ostream& operator<<(std::ostream& os, const Symbol& s) { return os << *s._text; }
+
+private:
+    const std::string* _text;
+
+    friend struct std::hash<Symbol>;
+};
+
+inline std::string operator+(const Symbol& lhs, std::string_view rhs)
+{
+    return std::string(lhs.str()).append(rhs);
+}
+inline std::string operator+(std::string lhs, const Symbol& rhs)
+{
+    return std::move(lhs.append(rhs.str()));
+}
+inline std::string operator+(const char* lhs, const Symbol& rhs) { return std::string(lhs) + rhs; }
+inline std::string operator+(const Symbol& lhs, char rhs) { return lhs.str() + rhs; }
+
+template <>
+struct std::hash<Symbol> {
+    size_t operator()(const Symbol& s) const { return std::hash<const void*>{}(s._text); }
+};
+
+template <>
+struct std::formatter<Symbol> : std::formatter<std::string_view> {
+    auto format(const Symbol& s, auto& ctx) const
+    {
+        return std::formatter<std::string_view>::format(s.str(), ctx);
+    }
+};
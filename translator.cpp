@@ -19,29 +19,66 @@
 #include "translator.h"
 
 #include "printer.h"
-
+#include "profiler.h"
+#include "stats.h"
+#include "snapshot.h"
 #include "yaml.h"
 
+#include <algorithm>
+#include <ranges>
 #include <regex>
 
 using namespace std;
 
-void addTypeAttributes(TypeUsage& typeUsage, const YamlMap<>& attributesMap)
+Pattern::Pattern(string patternText) : text(std::move(patternText))
+{
+    if (!text.empty() && text.front() == '/')
+        regex.emplace(text.begin() + 1, text.end());
+}
+
+Pattern makePattern(string patternText, const YamlNode& yaml)
+{
+    try {
+        return Pattern(std::move(patternText));
+    } catch (const regex_error& e) {
+        throw YamlException(yaml, "invalid regular expression: "s + e.what());
+    }
+}
+
+//! Pattern::matches(), counting regex evaluations for \p listName in the statistics
+bool countedMatch(const Pattern& pattern, string_view s, string_view listName)
+{
+    if (pattern.regex && pattern.text != s)
+        Stats::add("regex evaluations", listName);
+    return pattern.matches(s);
+}
+
+//! The type for references not replaced with anything in the configuration
+TypeUsage unmappedRefType()
+{
+    // Unless the configuration says how to import references, they are not imported at all
+    // (Printer warns about empty imports), rather than included with their raw $ref paths
+    TypeUsage tu;
+    tu.setImportRenderer({});
+    return tu;
+}
+
+void addTypeAttributes(TypeDefinition& definition, const YamlMap<>& attributesMap)
 {
     for (const auto& [attrName, attrData] : attributesMap) {
         if (attrName == "type")
             continue;
         switch (attrData.Type()) {
         case YAML::NodeType::Null:
-            typeUsage.attributes.emplace(std::move(attrName), string {});
+            definition.attributes.emplace(std::move(attrName), string {});
             break;
         case YAML::NodeType::Scalar:
-            typeUsage.attributes.emplace(std::move(attrName), attrData.as<string>());
+            definition.attributes.emplace(std::move(attrName), attrData.as<string>());
             break;
         case YAML::NodeType::Sequence:
             if (const auto& seq = attrData.as<YamlSequence<string>>(); seq.size() > 0)
-                typeUsage.lists.emplace(std::move(attrName),
-                                        vector<string>{seq.begin(), seq.end()});
+                definition.lists.emplace(std::move(attrName),
+                                         vector<string>{seq.begin(), seq.end()});
             break;
         default:
             throw YamlException(attrData, "Malformed attribute");
@@ -49,7 +86,7 @@ void addTypeAttributes(TypeUsage& typeUsage, const YamlMap<>& attributesMap)
     }
 }
 
-TypeUsage parseTargetType(const YamlNode& yamlTypeNode)
+TypeUsage parseTargetType(const YamlNode& yamlTypeNode, TypeDefinition& definition)
 {
     using namespace YAML::NodeType;
     if (yamlTypeNode.Type() == Null)
@@ -59,15 +96,17 @@ TypeUsage parseTargetType(const YamlNode& yamlTypeNode)
 
     const auto yamlTypeMap = yamlTypeNode.as<YamlMap<>>();
     TypeUsage typeUsage{yamlTypeMap.get<string>("type", {})};
-    addTypeAttributes(typeUsage, yamlTypeMap);
+    addTypeAttributes(definition, yamlTypeMap);
     return typeUsage;
 }
 
 TypeUsage parseTargetType(const YamlNode& yamlTypeNode,
                           const YamlMap<>& commonAttributesYaml)
 {
-    auto tu = parseTargetType(yamlTypeNode);
-    addTypeAttributes(tu, commonAttributesYaml);
+    TypeDefinition definition;
+    auto tu = parseTargetType(yamlTypeNode, definition);
+    addTypeAttributes(definition, commonAttributesYaml);
+    tu.setDefinition(std::move(definition));
     return tu;
 }
 
@@ -124,20 +163,20 @@ void parseEntries(const YamlSequence<YamlMap<>>& entriesYaml,
     }
 }
 
-pair_vector_t<TypeUsage> parseTypeEntry(const YamlNode& targetTypeYaml,
-                                        const YamlMap<>& commonAttributesYaml = {})
+pattern_list_t<TypeUsage> parseTypeEntry(const YamlNode& targetTypeYaml,
+                                         const YamlMap<>& commonAttributesYaml = {})
 {
     switch (targetTypeYaml.Type())
     {
         case YAML::NodeType::Scalar: // Use a type with no regard to format
         case YAML::NodeType::Map: // Same, with attributes for the target type
         {
-            return { { {},
+            return { { Pattern({}),
                        parseTargetType(targetTypeYaml, commonAttributesYaml) } };
         }
         case YAML::NodeType::Sequence: // A list of formats for the type
         {
-            pair_vector_t<TypeUsage> targetTypes;
+            pattern_list_t<TypeUsage> targetTypes;
             parseEntries(
                 targetTypeYaml.as<YamlSequence<YamlMap<>>>(),
                 [&targetTypes](string formatName, const YamlNode& typeYaml,
@@ -150,7 +189,7 @@ pair_vector_t<TypeUsage> parseTypeEntry(const YamlNode& targetTypeYaml,
                     {
                         formatName.pop_back();
                     }
-                    targetTypes.emplace_back(std::move(formatName),
+                    targetTypes.emplace_back(makePattern(std::move(formatName), typeYaml),
                         parseTargetType(typeYaml, commonAttrsYaml));
                 },
                 commonAttributesYaml);
@@ -161,114 +200,365 @@ pair_vector_t<TypeUsage> parseTypeEntry(const YamlNode& targetTypeYaml,
     }
 }
 
-subst_list_t loadStringMap(const YamlMap<>& yaml, string_view key)
+/// \brief Load a map of strings (or nulls) from the configuration
+///
+/// Keys enclosed in slashes are normalised to a single leading slash; if \p KeyT is Pattern,
+/// regular expressions are also compiled, with errors reported at the location of the key.
+template <typename KeyT = string>
+vector<pair<KeyT, optional<string>>> loadStringMap(const YamlMap<>& yaml, string_view key)
 {
-    subst_list_t stringMap;
-    for (const auto& [patternNode, subst] : yaml.maybeGet<YamlGenericMap>(key)) {
+    vector<pair<KeyT, optional<string>>> stringMap;
+    for (const auto& entry : yaml.maybeGet<YamlGenericMap>(key)) {
+        // Not using structured bindings, for GCC's sake: they confuse it in templates
+        const auto& patternNode = entry.first;
+        const auto& subst = entry.second;
         auto pattern = patternNode.as<string>();
         if (pattern.empty()) [[unlikely]]
-            clog << patternNode.location()
-                 << ": warning: empty pattern in substitutions, skipping\n";
+            warningLog() << patternNode.location()
+                         << ": warning: empty pattern in substitutions, skipping";
         else if (pattern.size() > 1 && pattern.front() != '/' && pattern.back() == '/') [[unlikely]]
-            clog << patternNode.location() << ": warning: invalid regular expression, skipping\n"
-                    "(use a regex with \\/ to match strings beginning with /)\n";
+            warningLog() << patternNode.location()
+                         << ": warning: invalid regular expression, skipping\n"
+                            "(use a regex with \\/ to match strings beginning with /)";
         else {
             if (pattern.front() == '/' && pattern.back() == '/')
                 pattern.pop_back();
+            KeyT stringMapKey = [&pattern, &patternNode] {
+                if constexpr (std::is_same_v<KeyT, Pattern>)
+                    return makePattern(std::move(pattern), patternNode);
+                else
+                    return std::move(pattern);
+            }();
             if (!subst.IsMap())
-                stringMap.emplace_back(pattern, subst.as<string>());
+                stringMap.emplace_back(std::move(stringMapKey), subst.as<string>());
             else if (subst.size() != 0) { // empty() would also check IsDefined() - again
-                clog << subst.location()
-                     << ": warning: non-empty maps have no meaning in substitutions\n"
-                     << "(put literal {} to indicate entry removal)\n";
+                warningLog() << subst.location()
+                             << ": warning: non-empty maps have no meaning in substitutions\n"
+                             << "(put literal {} to indicate entry removal)";
             } else
-                stringMap.emplace_back(pattern, nullopt);
+                stringMap.emplace_back(std::move(stringMapKey), nullopt);
         }
     }
     return stringMap;
 }
 
-Translator::Translator(const path& configFilePath, path outputDirPath,
-                       Verbosity verbosity)
-    : _verbosity(verbosity), _outputDirPath(std::move(outputDirPath))
+/// Bump this whenever the snapshot layout or the way the configuration is interpreted changes
+constexpr auto ConfigSnapshotVersion = 2;
+
+Translator::Translator(const path& configFilePath, path outputDirPath, const path& snapshotPath)
+    : _unmappedRefType(unmappedRefType()), _outputDirPath(std::move(outputDirPath))
+{
+    infoLog() << "Using config file at " << configFilePath;
+    const Profiler::Scope _profilerScope(Profiler::Configuration, configFilePath.string());
+
+    // Both the snapshot and the regeneration manifest are only valid for the same configuration
+    if (const auto configContents = readFile(configFilePath.string()); !configContents.empty())
+        _configKey = hashContents(configContents);
+    // The way the configuration is interpreted may change with any rebuild of GTAD
+    const auto useSnapshot =
+        !snapshotPath.empty() && !_configKey.empty() && !generatorKey().empty();
+    const auto snapshotKey = generatorKey() + '/' + _configKey;
+
+    MustacheConfig mustacheConfig;
+    if (!useSnapshot || !loadSnapshot(snapshotPath, snapshotKey, mustacheConfig)) {
+        mustacheConfig = loadConfig(configFilePath);
+        if (useSnapshot)
+            saveSnapshot(snapshotPath, snapshotKey, mustacheConfig);
+    }
+    if (LogMessage::enabled(Verbosity::Debug))
+        dumpTypesMap();
+
+    Printer::context_type env;
+    for (const auto& [cName, cValue] : mustacheConfig.constants)
+        env.emplace(cName, cValue);
+
+    for (const auto& [pName, pValue] : mustacheConfig.partials)
+        env.emplace(pName, makePartial(pValue, mustacheConfig.delimiter));
+
+    _printer = make_unique<Printer>(std::move(env), configFilePath.parent_path(),
+                                    mustacheConfig.outFilesList, mustacheConfig.delimiter, *this);
+}
+
+Translator::MustacheConfig Translator::loadConfig(const path& configFilePath)
 {
-    cout << "Using config file at " << configFilePath << endl;
     const auto configY = YamlNode::fromFile(configFilePath).as<YamlMap<YamlMap<>>>();
 
     if (const auto& analyzerYaml = configY["analyzer"]) {
-        _substitutions = loadStringMap(*analyzerYaml, "subst");
-        _identifiers = loadStringMap(*analyzerYaml, "identifiers");
+        // Errors in the YAML itself already come with the location; only errors in
+        // the regular expressions need it added
+        const auto substitutions = loadStringMap(*analyzerYaml, "subst");
+        try {
+            _substitutions = TextSubstitutions(substitutions);
+        } catch (const Exception& e) {
+            throw YamlException(analyzerYaml->get("subst"), e.message);
+        }
+        _identifiers = loadStringMap<Pattern>(*analyzerYaml, "identifiers");
 
+        pair_vector_t<pattern_list_t<TypeUsage>> typesMap;
         parseEntries(
             analyzerYaml->get<YamlSequence<YamlMap<>>>("types", {}),
-            [this](const string& name, const YamlNode& typeYaml, const YamlMap<>& commonAttrsYaml) {
-                _typesMap.emplace_back(name, parseTypeEntry(typeYaml, commonAttrsYaml));
+            [&typesMap](const string& name, const YamlNode& typeYaml,
+                        const YamlMap<>& commonAttrsYaml) {
+                typesMap.emplace_back(name, parseTypeEntry(typeYaml, commonAttrsYaml));
             });
 
         if (const auto& referencesYaml = analyzerYaml->maybeGet<YamlMap<>>("references")) {
-            referencesYaml->maybeLoad("importRenderer", &_importRenderer);
-            ranges::copy(referencesYaml->maybeGet<YamlSequence<string>>("inline"),
-                         back_inserter(_inlinedRefs));
+            string importRenderer;
+            if (referencesYaml->maybeLoad("importRenderer", &importRenderer))
+                _unmappedRefType.setImportRenderer(std::move(importRenderer));
+            for (const auto& inlinedRefYaml : referencesYaml->maybeGet<YamlSequence<>>("inline")) {
+                auto pattern = inlinedRefYaml.as<string>();
+                if (pattern.size() > 1 && pattern.front() == '/' && pattern.back() == '/')
+                    pattern.pop_back();
+                _inlinedRefs.emplace_back(makePattern(std::move(pattern), inlinedRefYaml));
+            }
             parseEntries(referencesYaml->get<YamlSequence<YamlMap<>>>("replace", {}),
-                         [this](string_view name, const YamlNode& typeYaml,
+                         [this](string name, const YamlNode& typeYaml,
                                 const YamlMap<>& commonAttrsYaml) {
                              if (name.size() > 1 && name.front() == '/' && name.back() == '/')
-                                 name.remove_suffix(1);
-                             _refReplacements.emplace_back(
-                                 name, parseTargetType(typeYaml, commonAttrsYaml));
+                                 name.pop_back();
+                             auto tu = parseTargetType(typeYaml, commonAttrsYaml);
+                             // References not replaced with another type will be imported
+                             if (tu.empty())
+                                 tu.setImportRenderer(_unmappedRefType.importRenderer());
+                             _refReplacements.emplace_back(makePattern(std::move(name), typeYaml),
+                                                           std::move(tu));
                          });
         }
 
-        if (_verbosity == Verbosity::Debug) {
-            // TODO: dump identifier substitutions?
-            for (const auto& t : _typesMap) {
-                clog << "Type " << t.first << ":\n";
-                for (const auto& f : t.second) {
-                    clog << "  Format " << (f.first.empty() ? "(none)" : f.first) << ":\n"
-                         << "    mapped to " << (!f.second.name.empty() ? f.second.name : "(none)")
-                         << '\n';
-
-                    if (!f.second.attributes.empty()) {
-                        clog << "    attributes:\n";
-                        for (const auto& a : f.second.attributes)
-                            clog << "      " << a.first << " -> " << a.second << '\n';
-                    } else
-                        clog << "    no attributes\n";
-
-                    if (!f.second.lists.empty()) {
-                        clog << "    lists:\n";
-                        for (const auto& l : f.second.lists)
-                            clog << "      " << l.first << " (entries: " << l.second.size()
-                                 << ")\n";
-                    } else
-                        clog << "    no lists\n";
-                }
-            }
-            clog.flush();
-            // TODO: dump reference substitutions
-        }
+        // Several blocks for the same swagger type are merged, keeping the configuration order
+        for (auto&& [swType, swFormats] : typesMap)
+            for (auto&& [swFormat, mappedType] : swFormats)
+                _typesMap[swType].add(std::move(swFormat), std::move(mappedType));
     }
 
-    Printer::context_type env;
-    using namespace kainjow::mustache;
     const auto& mustacheYaml = configY.get("mustache");
-    const auto& delimiter = mustacheYaml.get<string>("delimiter", {});
-    for (const auto& [cName, cValue] : mustacheYaml.maybeGet<YamlMap<string>>("constants"))
-        env.emplace(cName, cValue);
-
-    for (const auto& [pName, pValue] : mustacheYaml.maybeGet<YamlMap<string>>("partials"))
-        env.emplace(pName, makePartial(pValue, delimiter));
+    MustacheConfig mustacheConfig{mustacheYaml.get<string>("delimiter", {}), {}, {},
+                                  mustacheYaml.get<string>("outFilesList", {})};
+    mustacheYaml.maybeLoad("constants", &mustacheConfig.constants);
+    mustacheYaml.maybeLoad("partials", &mustacheConfig.partials);
 
     const auto& templatesYaml = mustacheYaml.maybeGet<YamlMap<YamlMap<string>>>("templates");
     templatesYaml->maybeLoad("data", &_dataTemplates);
     templatesYaml->maybeLoad("api", &_apiTemplates);
+    return mustacheConfig;
+}
 
-    _printer = make_unique<Printer>(std::move(env), configFilePath.parent_path(),
-                                    mustacheYaml.get<string>("outFilesList", {}),
-                                    delimiter, *this);
+void saveTypeUsage(SnapshotWriter& snapshot, const TypeUsage& tu)
+{
+    snapshot.addString(tu.name);
+    const auto& definition = tu.definition();
+    snapshot.addNumber(definition.attributes.size());
+    for (const auto& [attrName, attrValue] : definition.attributes) {
+        snapshot.addString(attrName);
+        snapshot.addString(attrValue);
+    }
+    snapshot.addNumber(definition.lists.size());
+    for (const auto& [listName, listValues] : definition.lists) {
+        snapshot.addString(listName);
+        snapshot.addNumber(listValues.size());
+        for (const auto& v : listValues)
+            snapshot.addString(v);
+    }
+    snapshot.addString(definition.importRenderer);
 }
 
-Translator::~Translator() = default;
+TypeUsage loadTypeUsage(SnapshotReader& snapshot)
+{
+    TypeUsage tu{snapshot.takeString()};
+    TypeDefinition definition;
+    for (auto attrCount = snapshot.takeNumber(); attrCount > 0; --attrCount) {
+        auto attrName = snapshot.takeString();
+        definition.attributes.emplace(std::move(attrName), snapshot.takeString());
+    }
+    for (auto listCount = snapshot.takeNumber(); listCount > 0; --listCount) {
+        auto& list = definition.lists[snapshot.takeString()];
+        for (auto valueCount = snapshot.takeNumber(); valueCount > 0; --valueCount)
+            list.emplace_back(snapshot.takeString());
+    }
+    definition.importRenderer = snapshot.takeString();
+    tu.setDefinition(std::move(definition));
+    return tu;
+}
+
+void saveStrings(SnapshotWriter& snapshot, const pair_vector_t<string>& strings)
+{
+    snapshot.addNumber(strings.size());
+    for (const auto& [k, v] : strings) {
+        snapshot.addString(k);
+        snapshot.addString(v);
+    }
+}
+
+pair_vector_t<string> loadStrings(SnapshotReader& snapshot)
+{
+    pair_vector_t<string> result;
+    for (auto count = snapshot.takeNumber(); count > 0; --count) {
+        auto k = snapshot.takeString();
+        result.emplace_back(std::move(k), snapshot.takeString());
+    }
+    return result;
+}
+
+void Translator::saveSnapshot(const path& snapshotPath, string_view configKey,
+                              const MustacheConfig& mustacheConfig) const
+{
+    SnapshotWriter snapshot;
+    snapshot.addNumber(ConfigSnapshotVersion);
+    snapshot.addString(configKey);
+
+    const auto& substitutions = _substitutions.replacePairs();
+    snapshot.addNumber(substitutions.size());
+    for (const auto& [pattn, subst] : substitutions) {
+        snapshot.addString(pattn);
+        snapshot.addOptionalString(subst);
+    }
+    snapshot.addNumber(_identifiers.size());
+    for (const auto& [pattn, subst] : _identifiers) {
+        snapshot.addString(pattn.text);
+        snapshot.addOptionalString(subst);
+    }
+    snapshot.addNumber(_typesMap.size());
+    for (const auto& [swType, mapping] : _typesMap) {
+        snapshot.addString(swType);
+        snapshot.addNumber(mapping.entries.size());
+        for (const auto& [swFormat, mappedType] : mapping.entries) {
+            snapshot.addString(swFormat.text);
+            saveTypeUsage(snapshot, *mappedType);
+        }
+    }
+    snapshot.addString(_unmappedRefType.importRenderer());
+    snapshot.addNumber(_inlinedRefs.size());
+    for (const auto& pattn : _inlinedRefs)
+        snapshot.addString(pattn.text);
+    snapshot.addNumber(_refReplacements.size());
+    for (const auto& [pattn, mappedType] : _refReplacements) {
+        snapshot.addString(pattn.text);
+        saveTypeUsage(snapshot, mappedType);
+    }
+
+    saveStrings(snapshot, _dataTemplates);
+    saveStrings(snapshot, _apiTemplates);
+    snapshot.addString(mustacheConfig.delimiter);
+    saveStrings(snapshot, mustacheConfig.constants);
+    saveStrings(snapshot, mustacheConfig.partials);
+    snapshot.addString(mustacheConfig.outFilesList);
+
+    if (!snapshot.saveTo(snapshotPath))
+        debugLog() << "Could not save the configuration snapshot to " << snapshotPath;
+}
+
+bool Translator::loadSnapshot(const path& snapshotPath, string_view configKey,
+                              MustacheConfig& mustacheConfig)
+{
+    const MappedFile snapshotFile(snapshotPath);
+    if (snapshotFile.contents().empty())
+        return false;
+
+    SnapshotReader snapshot(snapshotFile.contents());
+    try {
+        if (snapshot.takeNumber() != ConfigSnapshotVersion || snapshot.takeString() != configKey)
+            return false;
+
+        subst_list_t substitutions;
+        for (auto count = snapshot.takeNumber(); count > 0; --count) {
+            auto pattn = snapshot.takeString();
+            substitutions.emplace_back(std::move(pattn), snapshot.takeOptionalString());
+        }
+        _substitutions = TextSubstitutions(substitutions);
+        for (auto count = snapshot.takeNumber(); count > 0; --count) {
+            Pattern pattn(snapshot.takeString());
+            _identifiers.emplace_back(std::move(pattn), snapshot.takeOptionalString());
+        }
+        for (auto typeCount = snapshot.takeNumber(); typeCount > 0; --typeCount) {
+            auto& mapping = _typesMap[snapshot.takeString()];
+            for (auto formatCount = snapshot.takeNumber(); formatCount > 0; --formatCount) {
+                Pattern swFormat(snapshot.takeString());
+                mapping.add(std::move(swFormat), loadTypeUsage(snapshot));
+            }
+        }
+        _unmappedRefType.setImportRenderer(snapshot.takeString());
+        for (auto count = snapshot.takeNumber(); count > 0; --count)
+            _inlinedRefs.emplace_back(snapshot.takeString());
+        for (auto count = snapshot.takeNumber(); count > 0; --count) {
+            Pattern pattn(snapshot.takeString());
+            _refReplacements.emplace_back(std::move(pattn), loadTypeUsage(snapshot));
+        }
+
+        _dataTemplates = loadStrings(snapshot);
+        _apiTemplates = loadStrings(snapshot);
+        mustacheConfig.delimiter = snapshot.takeString();
+        mustacheConfig.constants = loadStrings(snapshot);
+        mustacheConfig.partials = loadStrings(snapshot);
+        mustacheConfig.outFilesList = snapshot.takeString();
+        if (!snapshot.atEnd())
+            throw Exception("Unexpected data at the end of the snapshot");
+    } catch (const Exception& e) {
+        warningLog() << snapshotPath << ": " << e.message
+                     << ", ignoring the configuration snapshot";
+        resetConfig();
+        return false;
+    } catch (const regex_error& e) {
+        warningLog() << snapshotPath << ": " << e.what()
+                     << ", ignoring the configuration snapshot";
+        resetConfig();
+        return false;
+    }
+    debugLog() << "Loaded configuration from the snapshot at " << snapshotPath;
+    return true;
+}
+
+void Translator::dumpTypesMap() const
+{
+    // TODO: dump identifier substitutions?
+    vector<string_view> swTypes;
+    swTypes.reserve(_typesMap.size());
+    for (const auto& swType : views::keys(_typesMap))
+        swTypes.emplace_back(swType);
+    ranges::sort(swTypes);
+    for (const auto& swType : swTypes) {
+        LogMessage msg(Verbosity::Debug, clog);
+        msg << "Type " << swType << ':';
+        for (const auto& [swFormat, mappedType] : _typesMap.find(swType)->second.entries) {
+            msg << "\n  Format " << (swFormat.text.empty() ? "(none)" : swFormat.text) << ":\n"
+                << "    mapped to "
+                << (!mappedType->name.empty() ? mappedType->name.str() : "(none)");
+
+            if (!mappedType->attributes().empty()) {
+                msg << "\n    attributes:";
+                for (const auto& a : mappedType->attributes())
+                    msg << "\n      " << a.first << " -> " << a.second;
+            } else
+                msg << "\n    no attributes";
+
+            if (!mappedType->lists().empty()) {
+                msg << "\n    lists:";
+                for (const auto& l : mappedType->lists())
+                    msg << "\n      " << l.first << " (entries: " << l.second.size() << ')';
+            } else
+                msg << "\n    no lists";
+        }
+    }
+    // TODO: dump reference substitutions
+}
+
+void Translator::resetConfig()
+{
+    _substitutions = {};
+    _identifiers.clear();
+    _typesMap.clear();
+    _unmappedRefType = unmappedRefType();
+    _inlinedRefs.clear();
+    _refReplacements.clear();
+    _dataTemplates.clear();
+    _apiTemplates.clear();
+}
+
+Translator::~Translator()
+{
+    debugLog() << "Identifier mapping cache: " << _identifiersCacheHits << " hit(s), "
+               << _identifiersCacheMisses << " miss(es)";
+}
 
 Translator::output_config_t Translator::outputConfig(const path& fileStem,
                                                      const Model& model) const
@@ -281,92 +571,137 @@ Translator::output_config_t Translator::outputConfig(const path& fileStem,
     return result;
 }
 
+void Translator::TypeMapping::add(Pattern&& format, TypeUsage&& mappedType)
+{
+    const auto idx = entries.size();
+    exactFormats.try_emplace(format.text, idx); // The first entry wins
+    if (format.regex)
+        regexFormats.push_back(idx);
+    entries.emplace_back(std::move(format), make_shared<const TypeUsage>(std::move(mappedType)));
+}
+
+const shared_ptr<const TypeUsage>& Translator::TypeMapping::find(string_view format,
+                                                                  mutex& cacheMutex) const
+{
+    {
+        const lock_guard lock(cacheMutex);
+        // Entries are never changed or removed once added, so they can be read after unlocking
+        if (const auto it = resolvedFormats.find(format); it != resolvedFormats.end())
+            return it->second;
+    }
+
+    // Find the first entry in the configuration order that matches either literally or as
+    // a regex; regexes only have to be tried up to the first literal match
+    auto foundIdx = entries.size();
+    if (const auto it = exactFormats.find(format); it != exactFormats.end())
+        foundIdx = it->second;
+    for (const auto idx : regexFormats) {
+        if (idx >= foundIdx)
+            break;
+        if (countedMatch(entries[idx].first, format, "types")) {
+            foundIdx = idx;
+            break;
+        }
+    }
+    // Another thread may have resolved the same format meanwhile, with the same result
+    const lock_guard lock(cacheMutex);
+    return resolvedFormats
+        .emplace(format, foundIdx < entries.size() ? entries[foundIdx].second : nullptr)
+        .first->second;
+}
+
 TypeUsage Translator::mapType(string_view swaggerType, string_view swaggerFormat,
                               string_view baseName) const
 {
     TypeUsage tu;
-    for (const auto& [swType, swFormats]: _typesMap)
-        if (swType == swaggerType)
-            for (const auto& [swFormat, mappedType]: swFormats)
-            {
-                if (swFormat == swaggerFormat
-                    || (!swFormat.empty() && swFormat.front() == '/'
-                        && regex_search(string(swaggerFormat),
-                                        regex(++swFormat.begin(), swFormat.end()))))
-                {
-                    // FIXME (#22): a source of great inefficiency.
-                    // TypeUsage should become a handle to an instance of
-                    // a newly-made TypeDefinition type that would own all
-                    // the stuff TypeUsage now has, except paramTypes
-                    tu = mappedType;
-                    goto conclusion;
-                }
-            }
-conclusion:
+    if (const auto it = _typesMap.find(swaggerType); it != _typesMap.end())
+        if (const auto& mappedType = it->second.find(swaggerFormat, _cachesMutex))
+            tu = *mappedType; // Cheap: the TypeDefinition is shared, not copied
+    if (Stats::enabled())
+        Stats::add(tu.name.empty() ? "type map misses" : "type map hits",
+                   string(swaggerType).append(1, '/').append(swaggerFormat));
+
     // Fallback chain: baseName, swaggerFormat, swaggerType
-    tu.baseName = baseName.empty()
-                      ? swaggerFormat.empty() ? swaggerType : swaggerFormat
-                      : baseName;
+    tu.baseName = Symbol(baseName.empty()
+                             ? swaggerFormat.empty() ? swaggerType : swaggerFormat
+                             : baseName);
     return tu;
 }
 
 string Translator::mapIdentifier(string_view baseName, const Identifier* scope, bool required) const
 {
-    auto scopedName = scope ? scope->qualifiedName() : string();
+    const auto scopeName = scope ? scope->qualifiedName() : string();
+    optional<string> cachedName;
+    {
+        const lock_guard lock(_cachesMutex);
+        if (const auto scopeIt = _identifiersCache.find(scopeName);
+            scopeIt != _identifiersCache.end())
+            if (const auto it = scopeIt->second.find(baseName); it != scopeIt->second.end()) {
+                ++_identifiersCacheHits;
+                cachedName = it->second;
+            }
+    }
+    // The regexes are run without holding the lock, so that other threads are not blocked
+    auto newName = cachedName ? std::move(*cachedName) : doMapIdentifier(baseName, scopeName);
+    if (!cachedName) {
+        const lock_guard lock(_cachesMutex);
+        ++_identifiersCacheMisses;
+        _identifiersCache[scopeName].try_emplace(string(baseName), newName);
+    }
+    if (newName.empty() && required)
+        throw Exception("Attempt to skip the required variable '"s.append(baseName).append(
+            "' - check 'identifiers' block in your gtad.yaml"));
+    return newName;
+}
+
+string Translator::doMapIdentifier(string_view baseName, string_view scopeName) const
+{
+    string scopedName{scopeName};
     scopedName.append(1, '/').append(baseName);
     string newName{baseName};
     for (const auto& [pattn, subst]: _identifiers)
     {
-        if (!pattn.empty() && pattn.front() == '/') {
-            const regex re(++pattn.begin(), pattn.end());
-            if (!subst && regex_search(scopedName, re)) {
-                if (_verbosity == Verbosity::Debug)
-                    cout << "Regex erasure: " << scopedName << "\n";
-                newName = {};
-                break;
+        if (const auto& re = pattn.regex) {
+            Stats::add("regex evaluations", "identifiers");
+            if (!subst) {
+                if (regex_search(scopedName, *re)) {
+                    debugLog() << "Regex erasure: " << scopedName;
+                    newName = {};
+                    break;
+                }
+                continue;
             }
-            if (auto&& replaced = regex_replace(scopedName, re, *subst);
+            if (auto&& replaced = regex_replace(scopedName, *re, *subst);
                 replaced != scopedName)
             {
-                if (_verbosity == Verbosity::Debug)
-                    cout << "Regex replace: " << scopedName << " -> " << replaced << '\n';
+                debugLog() << "Regex replace: " << scopedName << " -> " << replaced;
                 newName = replaced;
                 break;
             }
-        } else if (pattn == baseName || pattn == scopedName) {
+        } else if (pattn.text == baseName || pattn.text == scopedName) {
             newName = subst.value_or(""s);
             break;
         }
     }
-    if (newName.empty() && required)
-        throw Exception("Attempt to skip the required variable '"s.append(baseName).append(
-            "' - check 'identifiers' block in your gtad.yaml"));
     return newName;
 }
 
 TypeUsage Translator::mapReference(string_view fullRefPath) const
 {
-    TypeUsage tu;
+    auto tu = _unmappedRefType;
     for (const auto& [pattn, mappedType] : _refReplacements)
-        if (pattn == fullRefPath
-            || (!pattn.empty() && pattn.front() == '/'
-                && regex_search(string(fullRefPath), regex(++pattn.begin(), pattn.end()))))
+        if (countedMatch(pattn, fullRefPath, "references"))
         {
             tu = mappedType;
             break;
         }
-    if (tu.empty())
-        tu.importRenderer = _importRenderer;
-
-    tu.baseName = fullRefPath;
+    tu.baseName = Symbol(fullRefPath);
     return tu;
 }
 
 bool Translator::isRefInlined(string_view fullRefPath) const
 {
-    return ranges::any_of(_inlinedRefs, [fullRefPath](string_view pattn) {
-        return pattn == fullRefPath
-               || (!pattn.empty() && pattn.front() == '/'
-                   && regex_search(string(fullRefPath), regex(pattn.begin() + 1, pattn.end() - 1)));
+    return ranges::any_of(_inlinedRefs, [fullRefPath](const Pattern& pattn) {
+        return countedMatch(pattn, fullRefPath, "inlined $refs");
     });
 }
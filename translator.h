@@ -18,14 +18,34 @@
 
 #pragma once
 
+#include "log.h"
 #include "model.h"
+#include "yaml.h"
 
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <regex>
 
 class Printer;
 
-enum class Verbosity { Quiet = 0, Basic, Debug };
+/// A string to match either literally or, if it starts with `/`, as a regular expression
+struct Pattern {
+    /// \param patternText a literal string or `/` followed by a regular expression (without
+    ///                    the trailing `/`); may throw std::regex_error on invalid regexes
+    explicit Pattern(std::string patternText);
+
+    std::string text; ///< As passed to the constructor
+    std::optional<std::regex> regex; ///< Only filled for regex patterns
+
+    [[nodiscard]] bool matches(std::string_view s) const
+    {
+        return text == s || (regex && std::regex_search(s.begin(), s.end(), *regex));
+    }
+};
+
+template <typename T>
+using pattern_list_t = std::vector<std::pair<Pattern, T>>;
 
 class Translator
 {
@@ -35,12 +55,15 @@ public:
     using path = std::filesystem::path;
     using output_config_t = std::vector<std::pair<path, string>>;
 
-    Translator(const path& configFilePath, path outputDirPath,
-               Verbosity verbosity);
+    /// \param snapshotPath where to cache the resolved configuration between runs (see
+    ///                     saveSnapshot()); empty to load it from \p configFilePath every time
+    Translator(const path& configFilePath, path outputDirPath, const path& snapshotPath = {});
     ~Translator();
 
-    [[nodiscard]] const subst_list_t& substitutions() const { return _substitutions; }
+    [[nodiscard]] const TextSubstitutions& substitutions() const { return _substitutions; }
     [[nodiscard]] const path& outputBaseDir() const { return _outputDirPath; }
+    /// A hash of the configuration file contents; empty if the file could not be read
+    [[nodiscard]] const string& configKey() const { return _configKey; }
     [[nodiscard]] Printer& printer() const { return *_printer; }
 
     [[nodiscard]] output_config_t outputConfig(const path& fileStem,
@@ -53,16 +76,62 @@ public:
     [[nodiscard]] bool isRefInlined(string_view fullRefPath) const;
 
 private:
-    Verbosity _verbosity;
-    subst_list_t _substitutions;
-    subst_list_t _identifiers;
+    /// Type mapping entries for one swagger type, indexed for lookups by format
+    struct TypeMapping {
+        /// All entries, in the order of the configuration file
+        pattern_list_t<std::shared_ptr<const TypeUsage>> entries;
+        /// Literal formats (and regex pattern texts) mapped to the first entry index with it
+        string_map_t<size_t> exactFormats;
+        /// Indices of regex entries, ascending
+        std::vector<size_t> regexFormats;
+        /// Lookup results by format, filled on demand; nullptr stands for no match
+        mutable string_map_t<std::shared_ptr<const TypeUsage>> resolvedFormats;
+
+        void add(Pattern&& format, TypeUsage&& mappedType);
+        /// Find the entry for \p format; \p cacheMutex guards resolvedFormats
+        [[nodiscard]] const std::shared_ptr<const TypeUsage>& find(string_view format,
+                                                                   std::mutex& cacheMutex) const;
+    };
+
+    [[nodiscard]] string doMapIdentifier(string_view baseName, string_view scopeName) const;
+
+    /// The part of the configuration used to construct the Printer
+    struct MustacheConfig {
+        string delimiter;
+        pair_vector_t<string> constants;
+        pair_vector_t<string> partials;
+        string outFilesList;
+    };
+    MustacheConfig loadConfig(const path& configFilePath);
+    /// \brief Restore the configuration saved by saveSnapshot()
+    /// \return false if there's no valid snapshot made for \p configKey at \p snapshotPath
+    bool loadSnapshot(const path& snapshotPath, string_view configKey,
+                      MustacheConfig& mustacheConfig);
+    void saveSnapshot(const path& snapshotPath, string_view configKey,
+                      const MustacheConfig& mustacheConfig) const;
+    void resetConfig();
+    void dumpTypesMap() const;
+
+    string _configKey;
+    TextSubstitutions _substitutions;
+    pattern_list_t<std::optional<string>> _identifiers;
+    /// Results of mapIdentifier(), by the qualified scope name and then by the base name;
+    /// erased identifiers are stored as empty strings
+    mutable string_map_t<string_map_t<string>> _identifiersCache;
+    mutable size_t _identifiersCacheHits = 0;
+    mutable size_t _identifiersCacheMisses = 0;
+    /// Guards the memoisation caches (_identifiersCache and TypeMapping::resolvedFormats),
+    /// as the Translator is shared by Analyzers working in parallel threads; it's only held
+    /// for cache lookups and insertions, not while computing the values to cache
+    mutable std::mutex _cachesMutex;
 
     /// In JSON/YAML, the below looks like:
     /// <swaggerType>: { <swaggerFormat>: <TypeUsage>, ... }, ...
-    pair_vector_t<pair_vector_t<TypeUsage>> _typesMap;
-    string _importRenderer;
-    std::vector<string> _inlinedRefs;
-    pair_vector_t<TypeUsage> _refReplacements;
+    string_map_t<TypeMapping> _typesMap;
+    /// Same as mapReference() result for references not found in _refReplacements
+    TypeUsage _unmappedRefType;
+    std::vector<Pattern> _inlinedRefs;
+    pattern_list_t<TypeUsage> _refReplacements;
 
     /// Mapping of file extensions to mustache templates
     pair_vector_t<string> _dataTemplates, _apiTemplates;
@@ -18,8 +18,10 @@
 
 #include "util.h"
 
+#include "log.h"
+
+#include <format>
 #include <fstream>
-#include <iostream>
 
 std::string readFile(const std::string& fileName)
 {
@@ -28,10 +30,29 @@ std::string readFile(const std::string& fileName)
     {
         // FIXME: Figure a better error reporting mechanism.
         // Once we fix this, we can use this function from Printer as well.
-        std::cerr << "Failed to open file: " << fileName << std::endl;
+        errorLog() << "Failed to open file: " << fileName;
         return "";
     }
     std::string result;
     getline(ifs, result, '\0'); // Won't work on files with NULs
     return result;
 }
+
+std::string escapeJson(std::string_view s)
+{
+    std::string result;
+    result.reserve(s.size());
+    for (const auto c : s)
+        switch (c) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += std::format("\\u{:04x}", int(c));
+            else
+                result.push_back(c);
+        }
+    return result;
+}
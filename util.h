@@ -18,16 +18,57 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <unordered_map>
 
 template <typename T>
 using pair_vector_t = std::vector<std::pair<std::string, T>>;
 using subst_list_t = pair_vector_t<std::optional<std::string>>;
 
+/// A hash for std::string keys that enables lookups by std::string_view without a temporary
+struct string_hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+template <typename T>
+using string_map_t = std::unordered_map<std::string, T, string_hash, std::equal_to<>>;
+
+/// \brief Immutable text shared by all copies of it
+///
+/// Meant for long strings, such as descriptions, that are copied around along with objects
+/// containing them but never modified: a copy only increments a reference counter.
+class SharedText {
+public:
+    SharedText() = default;
+    SharedText(std::string text)
+        : _text(text.empty() ? nullptr : std::make_shared<const std::string>(std::move(text)))
+    {}
+    SharedText(const char* text) : SharedText(std::string(text)) {}
+
+    [[nodiscard]] const std::string& str() const { return _text ? *_text : emptyText(); }
+    operator const std::string&() const { return str(); }
+
+    [[nodiscard]] bool empty() const { return !_text; }
+
+private:
+    std::shared_ptr<const std::string> _text;
+
+    static const std::string& emptyText()
+    {
+        static const std::string s;
+        return s;
+    }
+};
+
 std::string readFile(const std::string& fileName);
 
+/// Escape \p s to be put in a JSON string literal
+std::string escapeJson(std::string_view s);
+
 struct Exception
 {
     explicit Exception(std::string msg) noexcept : message(std::move(msg)) { }
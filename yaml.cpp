@@ -18,10 +18,16 @@
 
 #include "yaml.h"
 
+#include "log.h"
+#include "profiler.h"
+#include "stats.h"
+
 #include <yaml-cpp/node/parse.h>
 
-#include <iostream>
-#include <regex>
+#include <filesystem>
+#include <mutex>
+#include <spanstream>
+#include <unordered_map>
 
 using Node = YAML::Node;
 using namespace std;
@@ -31,17 +37,79 @@ YamlException::YamlException(const YamlNode& node, string_view msg) noexcept
 {}
 
 namespace {
-YAML::Node makeNodeFromFile(const string& fileName, const subst_list_t& replacePairs)
+//! Renumber backreferences in \p pattern so that it can be embedded after \p shift other groups
+string shiftBackreferences(string_view pattern, size_t shift)
+{
+    string result;
+    result.reserve(pattern.size());
+    for (auto it = pattern.begin(); it != pattern.end(); ++it) {
+        result.push_back(*it);
+        if (*it != '\\' || ++it == pattern.end())
+            continue;
+        if (*it < '1' || *it > '9') { // Not a backreference
+            result.push_back(*it);
+            continue;
+        }
+        size_t groupNumber = 0;
+        for (; it != pattern.end() && isdigit(*it); ++it)
+            groupNumber = groupNumber * 10 + size_t(*it - '0');
+        result += to_string(groupNumber + shift);
+        --it;
+    }
+    return result;
+}
+
+//! \brief Expand a std::regex_replace()-style format string for a match of a combined regex
+//!
+//! This follows the ECMAScript rules implemented by std::match_results::format(), except that
+//! the group numbers are relative to the group enclosing the original pattern.
+void appendFormatted(string& output, string_view format, const cmatch& match,
+                     size_t groupIndex, size_t groupCount)
+{
+    for (auto it = format.begin(); it != format.end(); ++it) {
+        if (*it != '$' || it + 1 == format.end()) {
+            output.push_back(*it);
+            continue;
+        }
+        switch (const auto c = *++it) {
+        case '$': output.push_back('$'); break;
+        case '&': output.append(match[groupIndex].first, match[groupIndex].second); break;
+        case '`': output.append(match.prefix().first, match.prefix().second); break;
+        case '\'': output.append(match.suffix().first, match.suffix().second); break;
+        default:
+            if (!isdigit(c)) {
+                output.push_back('$');
+                --it;
+                break;
+            }
+            auto groupNumber = size_t(c - '0');
+            if (it + 1 != format.end() && isdigit(*(it + 1)))
+                groupNumber = groupNumber * 10 + size_t(*++it - '0');
+            if (groupNumber == 0)
+                output.append(match[groupIndex].first, match[groupIndex].second);
+            else if (groupNumber <= groupCount)
+                output.append(match[groupIndex + groupNumber].first,
+                              match[groupIndex + groupNumber].second);
+        }
+    }
+}
+
+YAML::Node makeNodeFromFile(const string& fileName, const TextSubstitutions& substitutions)
 {
-    if (replacePairs.empty())
+    if (substitutions.empty())
         return YAML::LoadFile(fileName);
 
-    auto fileContents = readFile(fileName);
+    const auto fileContents = readFile(fileName);
     if (fileContents.empty())
         throw YAML::BadFile(fileName);
-    for (const auto& [pattn, subst] : replacePairs)
-        fileContents = regex_replace(fileContents, regex(pattn), subst.value_or(""));
-    return YAML::Load(fileContents);
+
+    // Reuse the buffer across files, to avoid reallocating it for every one of them
+    thread_local string substitutedContents;
+    Stats::add("regex evaluations", "substitutions");
+    if (!substitutions.apply(fileContents, substitutedContents))
+        return YAML::Load(fileContents);
+    ispanstream substitutedStream{span{substitutedContents}};
+    return YAML::Load(substitutedStream);
 }
 
 // The parameter has the type auto because views::split() returns a rather hideous-looking type
@@ -65,9 +133,137 @@ string unescapeJsonPointerComponent(const auto& escapedComponent)
 }
 } // namespace
 
-YamlNode YamlNode::fromFile(const string& fileName, const subst_list_t& replacePairs)
+TextSubstitutions::TextSubstitutions(const subst_list_t& replacePairs)
+    : _replacePairs(replacePairs)
 {
-    const auto n = makeNodeFromFile(fileName, replacePairs);
+    string combinedPattern;
+    size_t groupIndex = 1;
+    for (const auto& [pattn, subst] : replacePairs) {
+        size_t groupCount = 0;
+        try {
+            groupCount = regex(pattn).mark_count();
+        } catch (const regex_error& e) {
+            throw Exception("Invalid regular expression in substitutions: " + pattn + " ("
+                            + e.what() + ")");
+        }
+        if (!combinedPattern.empty())
+            combinedPattern.push_back('|');
+        combinedPattern.append(1, '(').append(shiftBackreferences(pattn, groupIndex)).append(1, ')');
+        _replacements.push_back({groupIndex, groupCount, subst.value_or("")});
+        groupIndex += groupCount + 1;
+    }
+    if (!_replacements.empty())
+        _combinedRegex.assign(combinedPattern);
+}
+
+bool TextSubstitutions::apply(string_view text, string& output) const
+{
+    output.clear();
+    bool matched = false;
+    auto copiedUpTo = text.data();
+    for (cregex_iterator it{text.data(), text.data() + text.size(), _combinedRegex}, end;
+         it != end; ++it) {
+        const auto& match = *it;
+        const auto replacementIt = ranges::find_if(_replacements, [&match](const Replacement& r) {
+            return match[r.groupIndex].matched;
+        });
+        output.append(copiedUpTo, match[0].first);
+        appendFormatted(output, replacementIt->format, match, replacementIt->groupIndex,
+                        replacementIt->groupCount);
+        copiedUpTo = match[0].second;
+        matched = true;
+    }
+    if (!matched)
+        return false;
+    output.append(copiedUpTo, text.data() + text.size());
+    return true;
+}
+
+namespace {
+//! \brief Parsed documents shared by all loads of the same file in a run
+//!
+//! The same file may be loaded several times: when it's both listed on the command line and
+//! $ref'ed, or when a model has to be reloaded for a different role. Documents are cached by
+//! the canonical file path, and only parsed again if the file modification time or size
+//! changes; they stay in the cache until released with YamlNode::releaseFile() or
+//! YamlNode::releaseAllFiles(). Every load gets its own deep copy of the document, since
+//! resolving Reference Objects may modify the tree.
+class DocumentCache {
+public:
+    Node load(const string& fileName, const TextSubstitutions& substitutions)
+    {
+        error_code ec;
+        const auto canonicalPath = filesystem::weakly_canonical(fileName, ec);
+        filesystem::file_time_type modificationTime;
+        uintmax_t fileSize = 0;
+        if (!ec)
+            modificationTime = filesystem::last_write_time(canonicalPath, ec);
+        if (!ec)
+            fileSize = filesystem::file_size(canonicalPath, ec);
+        if (ec) // Let makeNodeFromFile() deal with the problem
+            return makeNodeFromFile(fileName, substitutions);
+
+        const auto isCurrent = [&](const Entry& e) {
+            return e.modificationTime == modificationTime && e.fileSize == fileSize
+                   && e.substitutions == substitutions.replacePairs();
+        };
+        auto key = canonicalPath.string();
+        shared_ptr<const Entry> entry;
+        {
+            const lock_guard lock(_mutex);
+            if (const auto it = _entries.find(key); it != _entries.end())
+                entry = it->second;
+        }
+        // Parse and clone outside of the lock, so that other threads could load files meanwhile;
+        // cached documents are never modified, so several threads can clone the same one
+        if (!entry || !isCurrent(*entry)) {
+            entry = make_shared<const Entry>(modificationTime, fileSize,
+                                             substitutions.replacePairs(),
+                                             makeNodeFromFile(fileName, substitutions));
+            const lock_guard lock(_mutex);
+            _entries.insert_or_assign(std::move(key), entry);
+        }
+        return YAML::Clone(entry->root);
+    }
+
+    void release(const string& fileName)
+    {
+        error_code ec;
+        const auto canonicalPath = filesystem::weakly_canonical(fileName, ec);
+        if (ec)
+            return;
+        const lock_guard lock(_mutex);
+        _entries.erase(canonicalPath.string());
+    }
+
+    void clear()
+    {
+        const lock_guard lock(_mutex);
+        _entries.clear();
+    }
+
+private:
+    struct Entry {
+        filesystem::file_time_type modificationTime;
+        uintmax_t fileSize;
+        subst_list_t substitutions;
+        Node root;
+    };
+    mutex _mutex;
+    unordered_map<string, shared_ptr<const Entry>> _entries;
+};
+
+DocumentCache documentCache;
+} // namespace
+
+void YamlNode::releaseFile(const string& fileName) { documentCache.release(fileName); }
+
+void YamlNode::releaseAllFiles() { documentCache.clear(); }
+
+YamlNode YamlNode::fromFile(const string& fileName, const TextSubstitutions& substitutions)
+{
+    const Profiler::Scope _profilerScope(Profiler::Parsing, fileName);
+    const auto n = documentCache.load(fileName, substitutions);
     return {n, make_shared<Context>(fileName, n), AllowUndefined{}};
 }
 
@@ -100,26 +296,35 @@ YamlNode YamlNode::doResolveRef(OverrideMode overrideMode) const
         throw YamlException(refObj, "Malformed JSON Pointer in $ref (must start with /)");
     maybeRef->remove_prefix(2); // Remove leading #/
 
-    // The following closely implements https://datatracker.ietf.org/doc/html/rfc6901#section-4
-
     // YAML::Node copy constructor is broken (see
     // https://github.com/jbeder/yaml-cpp/issues/1275) so instead of tracking the last
     // (innermost) found value in a plain YamlNode we use an optional and reset it before
     // assigning to a new value.
-    optional<YamlNode> currentYaml = refObj.root();
-    for (auto unescapedNodeName : *maybeRef | views::split('/')) {
-        const auto nodeName = unescapeJsonPointerComponent(unescapedNodeName);
-        auto nextYaml = currentYaml->IsMap() ? YamlMap<>(*currentYaml)[nodeName]
-                                             : YamlSequence<>(*currentYaml)[stoul(nodeName)];
-        if (!nextYaml)
-            throw YamlException(
-                refObj, "Could not find the value pointed to by $ref, first failing component: "
-                            + nodeName);
-        if (!nextYaml->IsMap() && !nextYaml->IsSequence())
-            throw YamlException(refObj, "Could not resolve JSON Pointer: value at " + nodeName
-                                            + " is not a container");
-        currentYaml.reset();
-        currentYaml = *nextYaml;
+    optional<YamlNode> currentYaml;
+    // Schemas tend to be referred to from many places in the same document; only walk
+    // the pointer the first time and look it up afterwards
+    auto& resolvedPointers = _context->resolvedPointers;
+    if (const auto it = resolvedPointers.find(*maybeRef); it != resolvedPointers.end())
+        currentYaml = YamlNode(it->second, _context, AllowUndefined{});
+    else {
+        // The following closely implements
+        // https://datatracker.ietf.org/doc/html/rfc6901#section-4
+        currentYaml = refObj.root();
+        for (auto unescapedNodeName : *maybeRef | views::split('/')) {
+            const auto nodeName = unescapeJsonPointerComponent(unescapedNodeName);
+            auto nextYaml = currentYaml->IsMap() ? YamlMap<>(*currentYaml)[nodeName]
+                                                 : YamlSequence<>(*currentYaml)[stoul(nodeName)];
+            if (!nextYaml)
+                throw YamlException(
+                    refObj, "Could not find the value pointed to by $ref, first failing component: "
+                                + nodeName);
+            if (!nextYaml->IsMap() && !nextYaml->IsSequence())
+                throw YamlException(refObj, "Could not resolve JSON Pointer: value at " + nodeName
+                                                + " is not a container");
+            currentYaml.reset();
+            currentYaml = *nextYaml;
+        }
+        resolvedPointers.emplace(*maybeRef, static_cast<const Node&>(*currentYaml));
     }
     if (overrideMode == ApplyOverrides)
         for (auto overridable : {"summary", "description"})
@@ -130,7 +335,7 @@ YamlNode YamlNode::doResolveRef(OverrideMode overrideMode) const
     if (refObj.size() > 1 && !ranges::all_of(refObj, [](const pair<string, YamlNode>& p) {
             return p.first == "$ref" || p.first == "summary" || p.first == "description";
         }))
-        clog << refObj.location()
-             << ": Warning: non-summary, non-description keys next to $ref will be ignored\n";
+        warningLog() << refObj.location()
+                     << ": Warning: non-summary, non-description keys next to $ref will be ignored";
     return *currentYaml;
 }
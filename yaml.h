@@ -28,9 +28,40 @@
 
 #include <utility>
 #include <ranges>
+#include <regex>
 
 class YamlNode;
 
+/// \brief Regex substitutions applied to a text all at once, in a single pass
+///
+/// The patterns are combined into one regular expression; at each position of the text
+/// the first pattern (in the order of the list) that matches is replaced, and the replacement
+/// is not matched against the remaining patterns again. Replacement strings use the same syntax
+/// as in std::regex_replace(), with group references relative to each pattern.
+class TextSubstitutions {
+public:
+    TextSubstitutions() = default;
+    //! \throw Exception if one of the patterns is not a valid regular expression
+    explicit TextSubstitutions(const subst_list_t& replacePairs);
+
+    [[nodiscard]] bool empty() const { return _replacements.empty(); }
+    [[nodiscard]] const subst_list_t& replacePairs() const { return _replacePairs; }
+
+    //! \brief Apply the substitutions to \p text, writing the result to \p output
+    //! \return false if no pattern matched, in which case \p output is left empty
+    bool apply(std::string_view text, std::string& output) const;
+
+private:
+    struct Replacement {
+        size_t groupIndex; ///< The number of the group enclosing the whole pattern
+        size_t groupCount; ///< The number of groups inside the pattern
+        std::string format;
+    };
+    subst_list_t _replacePairs;
+    std::regex _combinedRegex;
+    std::vector<Replacement> _replacements;
+};
+
 struct YamlException : Exception {
     explicit YamlException(const YamlNode& node, std::string_view msg) noexcept;
 };
@@ -52,6 +83,8 @@ public:
     struct Context {
         std::string fileName;
         YAML::Node rootNode;
+        //! Nodes found by resolveRef(), by JSON Pointer (without the leading `#/`)
+        string_map_t<YAML::Node> resolvedPointers = {};
     };
     // This constructor is templated to prevent accidental construction from YamlNode and descendants
     template <class NodeT = YAML::Node>
@@ -61,7 +94,12 @@ public:
     {
         Mark(); // Throw YAML::InvalidNode if n is invalid
     }
-    static YamlNode fromFile(const std::string& fileName, const subst_list_t& replacePairs = {});
+    static YamlNode fromFile(const std::string& fileName,
+                             const TextSubstitutions& substitutions = {});
+    //! Drop the parsed document for \p fileName, if fromFile() keeps one
+    static void releaseFile(const std::string& fileName);
+    //! Drop all parsed documents kept by fromFile()
+    static void releaseAllFiles();
 
     const std::string& fileName() const { return _context->fileName; }
     YamlNode root() const { return {_context->rootNode, _context, AllowUndefined{}}; }